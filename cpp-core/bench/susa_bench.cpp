@@ -0,0 +1,304 @@
+// susa-bench: runs the SUSA workloads in bench/ and reports timing and
+// allocation statistics per workload.
+//
+//   susa-bench [--runs N] [--warmup N] [--json] [--no-jit] [file.susa|dir ...]
+//
+// Every run executes the script in a fresh Interpreter inside this process.
+// Allocations go through the same accounting operator new as the susa CLI
+// (susa_memory.hpp); each run installs an account, so the counts cover
+// everything the interpreter allocates during the run (lexing included)
+// and bytes are malloc's usable block sizes.
+// --json prints one machine-readable document for comparing builds; the
+// output hash changes when a workload's printed result does.
+
+// Count allocations with the allocator the susa CLI ships
+#define SUSA_ACCOUNTING_ALLOCATOR
+#include "susa_interpreter_v2.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef SUSA_BENCH_DIR
+#define SUSA_BENCH_DIR "bench"
+#endif
+
+namespace {
+
+struct BenchOptions {
+    int runs = 5;
+    int warmup = 1;
+    bool json = false;
+    bool jit = true;
+    std::vector<std::string> paths;
+};
+
+struct RunSample {
+    double ms;
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+struct BenchResult {
+    std::string name;
+    std::string file;
+    std::vector<RunSample> samples;
+    std::string output_hash;
+};
+
+// The .susa files named on the command line, with directories expanded
+std::vector<std::string> collect_workloads(const std::vector<std::string>& paths) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> files;
+    for (const std::string& path : paths) {
+        std::error_code error;
+        if (!fs::is_directory(path, error)) {
+            files.push_back(path);
+            continue;
+        }
+        std::vector<std::string> found;
+        for (const auto& entry : fs::directory_iterator(path, error)) {
+            if (entry.path().extension() == ".susa") {
+                found.push_back(entry.path().string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+    }
+    return files;
+}
+
+std::string workload_name(const std::string& file) {
+    size_t slash = file.find_last_of("/\\");
+    std::string name = file.substr(slash == std::string::npos ? 0 : slash + 1);
+    size_t dot = name.rfind('.');
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+std::string fnv1a_hex(const std::string& text) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    return hex;
+}
+
+std::string run_once(const std::string& source, bool jit, RunSample& sample) {
+    susa::MemoryAccount account;
+    auto start = std::chrono::steady_clock::now();
+    std::string output;
+    {
+        susa::MemoryAccount::Scope counting(&account);
+        susa::Interpreter interpreter;
+        interpreter.set_jit(jit);
+        output = interpreter.execute(source);
+    }
+    auto end = std::chrono::steady_clock::now();
+    sample.ms = std::chrono::duration<double, std::milli>(end - start).count();
+    sample.allocations = account.allocations();
+    sample.bytes = account.allocated();
+    return output;
+}
+
+// Nearest-rank percentile of a sorted sample
+double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    size_t middle = values.size() / 2;
+    return values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+struct Summary {
+    double median_ms;
+    double p95_ms;
+    double min_ms;
+    double mean_ms;
+    double allocations;  // Median per run
+    double bytes;        // Median per run
+};
+
+Summary summarize(const BenchResult& result) {
+    std::vector<double> times;
+    std::vector<double> allocations;
+    std::vector<double> bytes;
+    for (const RunSample& sample : result.samples) {
+        times.push_back(sample.ms);
+        allocations.push_back(static_cast<double>(sample.allocations));
+        bytes.push_back(static_cast<double>(sample.bytes));
+    }
+    std::vector<double> sorted = times;
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0;
+    for (double ms : times) {
+        total += ms;
+    }
+    return {median(times), percentile(sorted, 95), sorted.front(), total / times.size(),
+            median(allocations), median(bytes)};
+}
+
+std::string json_string(const std::string& text) {
+    std::string quoted = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", c);
+            quoted += code;
+        } else {
+            quoted += static_cast<char>(c);
+        }
+    }
+    return quoted + "\"";
+}
+
+void print_json(const std::vector<BenchResult>& results, const BenchOptions& options) {
+    char line[512];
+    std::cout << "{\n  \"suite\": \"susa-bench\",\n";
+#ifdef __OPTIMIZE__
+    bool optimized = true;
+#else
+    bool optimized = false;
+#endif
+#ifdef __VERSION__
+    std::cout << "  \"compiler\": " << json_string(__VERSION__) << ",\n";
+#endif
+    std::cout << "  \"optimized\": " << (optimized ? "true" : "false") << ",\n"
+              << "  \"jit\": " << (options.jit ? "true" : "false") << ",\n"
+              << "  \"runs\": " << options.runs << ",\n"
+              << "  \"warmup\": " << options.warmup << ",\n"
+              << "  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& result = results[i];
+        Summary summary = summarize(result);
+        std::cout << (i == 0 ? "\n" : ",\n") << "    {\"name\": " << json_string(result.name)
+                  << ", \"file\": " << json_string(result.file);
+        std::snprintf(line, sizeof(line),
+                      ", \"median_ms\": %.3f, \"p95_ms\": %.3f, \"min_ms\": %.3f, \"mean_ms\": %.3f"
+                      ", \"allocations\": %.0f, \"allocated_bytes\": %.0f",
+                      summary.median_ms, summary.p95_ms, summary.min_ms, summary.mean_ms,
+                      summary.allocations, summary.bytes);
+        std::cout << line << ", \"output_hash\": \"" << result.output_hash << "\", \"samples_ms\": [";
+        for (size_t j = 0; j < result.samples.size(); j++) {
+            std::snprintf(line, sizeof(line), "%s%.3f", j == 0 ? "" : ", ", result.samples[j].ms);
+            std::cout << line;
+        }
+        std::cout << "]}";
+    }
+    std::cout << "\n  ]\n}\n";
+}
+
+void print_table(const std::vector<BenchResult>& results, const BenchOptions& options) {
+    char line[256];
+    std::printf("susa-bench: %d run(s) per workload after %d warmup run(s)%s\n\n", options.runs,
+                options.warmup, options.jit ? "" : ", JIT off");
+    std::printf("%-20s %11s %11s %11s %14s %14s\n", "workload", "median ms", "p95 ms", "min ms",
+                "allocs/run", "bytes/run");
+    for (const BenchResult& result : results) {
+        Summary summary = summarize(result);
+        std::snprintf(line, sizeof(line), "%-20s %11.2f %11.2f %11.2f %14.0f %14.0f\n",
+                      result.name.c_str(), summary.median_ms, summary.p95_ms, summary.min_ms,
+                      summary.allocations, summary.bytes);
+        std::cout << line;
+    }
+#ifndef __OPTIMIZE__
+    std::printf("\nNote: susa-bench was built without optimization; use a Release build for real numbers.\n");
+#endif
+}
+
+bool parse_arguments(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--runs" && has_value && std::atoi(argv[i + 1]) > 0) {
+            options.runs = std::atoi(argv[++i]);
+        } else if (arg == "--warmup" && has_value && std::atoi(argv[i + 1]) >= 0) {
+            options.warmup = std::atoi(argv[++i]);
+        } else if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--no-jit") {
+            options.jit = false;
+        } else if (arg == "-h" || arg == "--help") {
+            std::cout << "Usage: susa-bench [--runs N] [--warmup N] [--json] [--no-jit] [file.susa|dir ...]\n"
+                      << "Runs each workload N times (default 5) and reports median/p95 time and\n"
+                      << "allocations. Without paths, runs " << SUSA_BENCH_DIR << ".\n";
+            return false;
+        } else if (arg[0] == '-') {
+            std::cerr << "Error: Unknown option: " << arg << "\n";
+            return false;
+        } else {
+            options.paths.push_back(arg);
+        }
+    }
+    if (options.paths.empty()) {
+        options.paths.push_back(SUSA_BENCH_DIR);
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parse_arguments(argc, argv, options)) {
+        return 1;
+    }
+
+    std::vector<std::string> files = collect_workloads(options.paths);
+    if (files.empty()) {
+        std::cerr << "Error: No .susa workloads found\n";
+        return 1;
+    }
+
+    std::vector<BenchResult> results;
+    for (const std::string& file : files) {
+        std::ifstream in(file);
+        if (!in.is_open()) {
+            std::cerr << "Error: Could not open file: " << file << "\n";
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        std::string source = buffer.str();
+
+        BenchResult result;
+        result.name = workload_name(file);
+        result.file = file;
+        if (!options.json) {
+            std::cerr << "running " << result.name << "...\n";
+        }
+        RunSample sample;
+        for (int i = 0; i < options.warmup; i++) {
+            run_once(source, options.jit, sample);
+        }
+        for (int i = 0; i < options.runs; i++) {
+            std::string output = run_once(source, options.jit, sample);
+            if (i == 0) {
+                result.output_hash = fnv1a_hex(output);
+            }
+            result.samples.push_back(sample);
+        }
+        results.push_back(std::move(result));
+    }
+
+    if (options.json) {
+        print_json(results, options);
+    } else {
+        print_table(results, options);
+    }
+    return 0;
+}
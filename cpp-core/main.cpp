@@ -1,8 +1,21 @@
+// Lets --max-memory and --benchmark charge allocations to the interpreter
+#define SUSA_ACCOUNTING_ALLOCATOR
 #include "susa_interpreter_v2.hpp"
+#include "susa_build.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <chrono>
+#include <cstdlib>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <vector>
+
+// Where `susa build` finds the runtime headers unless told otherwise
+#ifndef SUSA_RUNTIME_DIR
+#define SUSA_RUNTIME_DIR "."
+#endif
 
 void print_banner() {
     std::cout << "\n";
@@ -17,17 +30,40 @@ void print_banner() {
 
 void print_help() {
     print_banner();
-    std::cout << "Usage: susa [options] [file]\n\n";
+    std::cout << "Usage: susa [options] [file]\n";
+    std::cout << "       susa build [options] file [-o output]\n\n";
     std::cout << "Options:\n";
     std::cout << "  -h, --help       Show this help message\n";
     std::cout << "  -v, --version    Show version information\n";
     std::cout << "  -e, --eval CODE  Execute SUSA code directly\n";
-    std::cout << "  --benchmark      Show execution time\n";
+    std::cout << "  --benchmark      Show time per phase, calls, Values created and peak memory\n";
+    std::cout << "  --repeat N       Rerun N more times with warm caches; report min/median/stddev\n";
+    std::cout << "  --profile        Report calls, time per function and line hits (on stderr)\n";
+    std::cout << "  --profile=hw     Also count cycles, instructions and cache/branch misses (Linux)\n";
+    std::cout << "  --sample FILE    Sample call stacks (1 ms CPU timer) into FILE as folded stacks\n";
+    std::cout << "  --trace FILE     Write calls, imports and phases to FILE as Chrome trace JSON\n";
+    std::cout << "  --stats          Count statements and operations by kind (SUSA_STATS builds)\n";
+    std::cout << "  --max-depth N    Call depth before a RecursionError (default: stack size)\n";
+    std::cout << "  --max-instructions N  Loop iterations plus calls before a BudgetError\n";
+    std::cout << "  --max-time MS    Execution time before a BudgetError\n";
+    std::cout << "  --max-memory MB  Memory the program may hold before a MemoryError\n";
+    std::cout << "  --no-inline      Keep every function call (for debugging)\n";
+    std::cout << "  --no-jit         Interpret hot loops instead of compiling them\n";
+    std::cout << "\n";
+    std::cout << "Build options (susa build):\n";
+    std::cout << "  -o FILE          Executable to write (default: script name)\n";
+    std::cout << "  --cxx CMD        C++ compiler (default: $CXX or c++)\n";
+    std::cout << "  --runtime DIR    Runtime headers (default: $SUSA_RUNTIME_DIR or build tree)\n";
+    std::cout << "  --emit-cpp FILE  Keep the generated C++ source\n";
+    std::cout << "  --no-lower       Interpret every function instead of compiling numeric ones\n";
     std::cout << "\n";
     std::cout << "Examples:\n";
     std::cout << "  susa script.susa              Run a SUSA file\n";
     std::cout << "  susa -e \"print 'Hello'\"        Execute code directly\n";
     std::cout << "  susa --benchmark script.susa  Run with timing\n";
+    std::cout << "  susa --profile script.susa    Find the slow functions and lines\n";
+    std::cout << "  susa --profile=hw script.susa See whether dispatch, allocation or memory dominates\n";
+    std::cout << "  susa build script.susa -o app Build a standalone executable\n";
     std::cout << "\n";
 }
 
@@ -55,6 +91,259 @@ std::string read_file(const std::string& filename) {
     return buffer.str();
 }
 
+// susa build script.susa -o app
+int build_command(int argc, char* argv[]) {
+    susa::BuildOptions options;
+    const char* env_cxx = std::getenv("CXX");
+    const char* env_runtime = std::getenv("SUSA_RUNTIME_DIR");
+    options.compiler = env_cxx != nullptr ? env_cxx : "c++";
+    options.runtime_dir = env_runtime != nullptr ? env_runtime : SUSA_RUNTIME_DIR;
+    
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "-o" && has_value) {
+            options.output = argv[++i];
+        } else if (arg == "--cxx" && has_value) {
+            options.compiler = argv[++i];
+        } else if (arg == "--runtime" && has_value) {
+            options.runtime_dir = argv[++i];
+        } else if (arg == "--emit-cpp" && has_value) {
+            options.cpp_output = argv[++i];
+        } else if (arg == "--max-depth" && has_value && std::atol(argv[i + 1]) > 0) {
+            options.max_depth = std::atol(argv[++i]);
+        } else if (arg == "--no-inline") {
+            options.inline_functions = false;
+        } else if (arg == "--no-jit") {
+            options.jit = false;
+        } else if (arg == "--no-lower") {
+            options.lower_functions = false;
+        } else if (arg[0] == '-' || !options.script.empty()) {
+            std::cerr << "Error: Unexpected build argument: " << arg << "\n";
+            return 1;
+        } else {
+            options.script = arg;
+        }
+    }
+    
+    if (options.script.empty()) {
+        std::cerr << "Error: No script given (usage: susa build script.susa -o app)\n";
+        return 1;
+    }
+    if (options.output.empty()) {
+        size_t slash = options.script.find_last_of("/\\");
+        options.output = options.script.substr(slash == std::string::npos ? 0 : slash + 1);
+        size_t dot = options.output.rfind('.');
+        if (dot != std::string::npos && dot > 0) {
+            options.output.erase(dot);
+        }
+    }
+    
+    return susa::ProgramBuilder(options).build();
+}
+
+// Command-line settings for running a program
+struct RunOptions {
+    bool benchmark = false;
+    bool profile = false;
+    bool profile_counters = false;  // --profile=hw
+    bool stats = false;
+    std::string sample_output;  // Folded stacks file for --sample
+    std::string trace_output;   // Chrome trace file for --trace
+    long max_depth = 0;
+    susa::ExecutionBudget budget;  // --max-instructions / --max-time / --max-memory
+    long repeat = 0;  // Warm reruns after the first run
+    bool no_inline = false;
+    bool no_jit = false;
+};
+
+void configure(susa::Interpreter& interpreter, const RunOptions& options) {
+    if (options.max_depth > 0) {
+        interpreter.set_max_call_depth(options.max_depth);
+    }
+    interpreter.set_budget(options.budget);
+    interpreter.set_memory_tracking(options.benchmark);
+    // Profiled runs keep every call and statement in the interpreter; counted
+    // runs only need loops interpreted
+    interpreter.set_inline(!options.no_inline && !options.profile);
+    interpreter.set_jit(!options.no_jit && !options.profile && !options.stats);
+}
+
+// Timings of one run: the interpreter's phases plus the wall time around it
+struct TimedRun {
+    susa::ExecutionStats stats;
+    double total_ms;
+};
+
+TimedRun timed_execute(susa::Interpreter& interpreter, const std::string& source, std::string& output) {
+    auto start = std::chrono::high_resolution_clock::now();
+    output = interpreter.execute(source);
+    auto end = std::chrono::high_resolution_clock::now();
+    return {interpreter.stats(), std::chrono::duration<double, std::milli>(end - start).count()};
+}
+
+void print_benchmark(const TimedRun& run) {
+    const susa::ExecutionStats& stats = run.stats;
+    char line[160];
+    std::cout << "\n[Execution time: " << run.total_ms << " ms]\n";
+    std::snprintf(line, sizeof(line),
+                  "  lex       %12.3f ms\n  optimize  %12.3f ms\n  execute   %12.3f ms"
+                  "  (JIT compile %.3f ms)\n",
+                  stats.lex_ms, stats.optimize_ms, stats.execute_ms, stats.jit_compile_ms);
+    std::cout << line;
+    std::cout << "  tokens    " << stats.tokens << "\n";
+    std::cout << "  calls     " << stats.calls << " SUSA, " << stats.builtin_calls << " builtin\n";
+    std::cout << "  budget    " << stats.instructions << " instructions (loop iterations and calls)\n";
+    if (susa::MemoryAccount::enabled()) {
+        std::snprintf(line, sizeof(line), "  memory    %.1f MB peak held by the interpreter\n",
+                      stats.memory_peak / (1024.0 * 1024.0));
+        std::cout << line;
+    }
+    double rss = static_cast<double>(susa::peak_resident_bytes());
+    if (rss > 0) {
+        std::snprintf(line, sizeof(line), "  peak RSS  %.1f MB\n", rss / (1024.0 * 1024.0));
+        std::cout << line;
+    }
+    uint64_t values = 0;
+    std::string by_type;
+    for (size_t i = 0; i < susa::ValueCounters::TYPE_COUNT; i++) {
+        if (stats.values_created[i] == 0) {
+            continue;
+        }
+        values += stats.values_created[i];
+        by_type += by_type.empty() ? "" : ", ";
+        by_type += susa::value_type_name(static_cast<susa::ValueType>(i));
+        by_type += " " + std::to_string(stats.values_created[i]);
+    }
+    std::cout << "  values    " << values << " created" << (by_type.empty() ? "" : " (" + by_type + ")") << "\n";
+}
+
+// min / median / stddev of each phase over the warm reruns
+void print_repeat_summary(const std::vector<TimedRun>& runs) {
+    struct Column {
+        const char* name;
+        double (*get)(const TimedRun&);
+    };
+    const Column columns[] = {
+        {"lex", [](const TimedRun& run) { return run.stats.lex_ms; }},
+        {"optimize", [](const TimedRun& run) { return run.stats.optimize_ms; }},
+        {"execute", [](const TimedRun& run) { return run.stats.execute_ms; }},
+        {"total", [](const TimedRun& run) { return run.total_ms; }},
+    };
+    char line[160];
+    std::cout << "\n[Repeat: " << runs.size() << " warm run(s), ms]\n";
+    std::snprintf(line, sizeof(line), "  %-9s %12s %12s %12s\n", "", "min", "median", "stddev");
+    std::cout << line;
+    for (const Column& column : columns) {
+        std::vector<double> values;
+        double sum = 0;
+        for (const TimedRun& run : runs) {
+            values.push_back(column.get(run));
+            sum += values.back();
+        }
+        std::sort(values.begin(), values.end());
+        size_t middle = values.size() / 2;
+        double median = values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+        double mean = sum / values.size();
+        double variance = 0;
+        for (double value : values) {
+            variance += (value - mean) * (value - mean);
+        }
+        double stddev = values.size() > 1 ? std::sqrt(variance / (values.size() - 1)) : 0.0;
+        std::snprintf(line, sizeof(line), "  %-9s %12.3f %12.3f %12.3f\n", column.name, values.front(), median, stddev);
+        std::cout << line;
+    }
+}
+
+// Run one program (a file's contents or -e code); returns the exit code
+int run_source(const std::string& source, const RunOptions& options) {
+    susa::Interpreter interpreter;
+    configure(interpreter, options);
+    susa::Profiler profiler;
+    if (options.profile) {
+        interpreter.set_profiler(&profiler);
+    }
+    susa::HardwareCounters counters;
+    if (options.profile_counters) {
+        if (counters.open()) {
+            profiler.set_counters(&counters);
+        } else {
+            std::cerr << "Note: hardware counters unavailable: " << counters.error()
+                      << "; profiling without them\n";
+        }
+    }
+    susa::SamplingProfiler sampler;
+    if (!options.sample_output.empty()) {
+        if (!sampler.start()) {
+            std::cerr << "Error: Sampling profiler is not available on this platform\n";
+            return 1;
+        }
+        interpreter.set_sampler(&sampler);
+    }
+    susa::Tracer tracer;
+    if (!options.trace_output.empty()) {
+        interpreter.set_tracer(&tracer);
+    }
+    susa::OpStats op_stats;
+    if (options.stats) {
+        interpreter.set_op_stats(&op_stats);
+    }
+    
+    std::string output;
+    TimedRun first = timed_execute(interpreter, source, output);
+    profiler.stop();
+    sampler.stop();
+    
+    std::cout << output;
+    if (options.profile) {
+        std::cout.flush();
+        for (uint64_t created : first.stats.values_created) {
+            profiler.count_allocations(created);
+        }
+        profiler.report(std::cerr, source);
+    }
+    if (options.stats) {
+        std::cout.flush();
+        op_stats.report(std::cerr);
+    }
+    if (!options.sample_output.empty()) {
+        std::ofstream folded(options.sample_output);
+        if (!folded.is_open()) {
+            std::cerr << "Error: Could not write " << options.sample_output << "\n";
+            return 1;
+        }
+        sampler.write_folded(folded);
+        std::cerr << "[" << sampler.samples() << " samples written to " << options.sample_output << "]\n";
+    }
+    if (!options.trace_output.empty()) {
+        std::ofstream trace(options.trace_output);
+        if (!trace.is_open()) {
+            std::cerr << "Error: Could not write " << options.trace_output << "\n";
+            return 1;
+        }
+        tracer.write_json(trace);
+        std::cerr << "[" << tracer.event_count() << " trace events written to " << options.trace_output << "]\n";
+    }
+    
+    // Warm reruns in fresh interpreters; their output is discarded
+    std::vector<TimedRun> reruns;
+    for (long i = 0; i < options.repeat; i++) {
+        susa::Interpreter rerun;
+        configure(rerun, options);
+        std::string discarded;
+        reruns.push_back(timed_execute(rerun, source, discarded));
+    }
+    
+    if (options.benchmark) {
+        print_benchmark(first);
+    }
+    if (!reruns.empty()) {
+        print_repeat_summary(reruns);
+    }
+    
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         print_help();
@@ -62,13 +351,89 @@ int main(int argc, char* argv[]) {
     }
     
     std::string arg1 = argv[1];
-    bool benchmark = false;
+    if (arg1 == "build") {
+        return build_command(argc, argv);
+    }
+    susa::Interpreter::raise_stack_limit();
+    RunOptions options;
+    bool eval_mode = false;
+    std::string code;
+    std::string filename;
     
-    // Check for flags
+    // Check for flags; the first other argument is the script
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
         if (arg == "--benchmark") {
-            benchmark = true;
+            options.benchmark = true;
+        } else if (arg == "--profile") {
+            options.profile = true;
+        } else if (arg == "--profile=hw") {
+            options.profile = true;
+            options.profile_counters = true;
+        } else if (arg == "--stats") {
+            if (!susa::OpStats::ENABLED) {
+                std::cerr << "Error: --stats needs a build with SUSA_STATS "
+                          << "(cmake -DSUSA_STATS=ON, or make STATS=1)\n";
+                return 1;
+            }
+            options.stats = true;
+        } else if (arg == "--sample") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --sample expects an output file\n";
+                return 1;
+            }
+            options.sample_output = argv[++i];
+        } else if (arg == "--trace") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --trace expects an output file\n";
+                return 1;
+            }
+            options.trace_output = argv[++i];
+        } else if (arg == "--repeat") {
+            if (i + 1 >= argc || (options.repeat = std::atol(argv[i + 1])) <= 0) {
+                std::cerr << "Error: --repeat expects a positive number\n";
+                return 1;
+            }
+            i++;
+        } else if (arg == "--no-inline") {
+            options.no_inline = true;
+        } else if (arg == "--no-jit") {
+            options.no_jit = true;
+        } else if (arg == "--max-depth") {
+            if (i + 1 >= argc || (options.max_depth = std::atol(argv[i + 1])) <= 0) {
+                std::cerr << "Error: --max-depth expects a positive number\n";
+                return 1;
+            }
+            i++;
+        } else if (arg == "--max-instructions") {
+            if (i + 1 >= argc || (options.budget.instructions = std::strtoull(argv[i + 1], nullptr, 10)) == 0) {
+                std::cerr << "Error: --max-instructions expects a positive number\n";
+                return 1;
+            }
+            i++;
+        } else if (arg == "--max-time") {
+            if (i + 1 >= argc || (options.budget.wall_ms = std::atof(argv[i + 1])) <= 0) {
+                std::cerr << "Error: --max-time expects a positive number of milliseconds\n";
+                return 1;
+            }
+            i++;
+        } else if (arg == "--max-memory") {
+            double megabytes = i + 1 < argc ? std::atof(argv[i + 1]) : 0;
+            if (megabytes <= 0) {
+                std::cerr << "Error: --max-memory expects a positive number of megabytes\n";
+                return 1;
+            }
+            options.budget.memory_bytes = static_cast<size_t>(megabytes * 1024 * 1024);
+            i++;
+        } else if (arg == "-e" || arg == "--eval") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: No code provided for -e option\n";
+                return 1;
+            }
+            eval_mode = true;
+            code = argv[++i];
+        } else if (filename.empty()) {
+            filename = arg;
         }
     }
     
@@ -85,51 +450,22 @@ int main(int argc, char* argv[]) {
     }
     
     // Direct code execution
-    if (arg1 == "-e" || arg1 == "--eval") {
-        if (argc < 3) {
-            std::cerr << "Error: No code provided for -e option\n";
-            return 1;
-        }
-        
-        std::string code = argv[2];
-        susa::Interpreter interpreter;
-        
-        auto start = std::chrono::high_resolution_clock::now();
-        std::string output = interpreter.execute(code);
-        auto end = std::chrono::high_resolution_clock::now();
-        
-        std::cout << output;
-        
-        if (benchmark) {
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-            std::cout << "\n[Execution time: " << duration.count() / 1000.0 << " ms]\n";
-        }
-        
-        return 0;
+    if (eval_mode) {
+        return run_source(code, options);
     }
     
     // File execution
-    std::string filename = arg1;
+    if (filename.empty()) {
+        print_help();
+        return 0;
+    }
     
+    std::string source;
     try {
-        std::string source = read_file(filename);
-        susa::Interpreter interpreter;
-        
-        auto start = std::chrono::high_resolution_clock::now();
-        std::string output = interpreter.execute(source);
-        auto end = std::chrono::high_resolution_clock::now();
-        
-        std::cout << output;
-        
-        if (benchmark) {
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-            std::cout << "\n[Execution time: " << duration.count() / 1000.0 << " ms]\n";
-        }
-        
+        source = read_file(filename);
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << "\n";
         return 1;
     }
-    
-    return 0;
+    return run_source(source, options);
 }
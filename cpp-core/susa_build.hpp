@@ -0,0 +1,1034 @@
+#ifndef SUSA_BUILD_HPP
+#define SUSA_BUILD_HPP
+
+#include "susa_interpreter_v2.hpp"
+#include "susa_native.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace susa {
+
+// Lowering of pure numeric functions to C++ (run by `susa build`).
+//
+// A top-level FUNC defined once, whose name is only ever called, is lowered
+// when its body sticks to parameters and locals, numeric literals, + - * / %
+// **, comparisons, AND/OR/NOT, assignments (=, op=, ++, --), IF blocks,
+// WHILE / LOOP WHILE / LOOP FOR n TIMES loops with BREAK and CONTINUE,
+// RETURN, and calls to itself or to lowered functions defined before it.
+// Self tail calls become jumps back to the top of the function. The rest of
+// the program, and any call the lowered code can't finish (a non-numeric
+// argument, division by zero, running out of call depth), is interpreted;
+// see susa_native.hpp.
+//
+// Some interpreter behavior is only matched by staying clear of it: a name
+// is read only once the function has assigned it on every path (before that
+// the interpreter reads the global), conditions are comparisons or AND/OR/NOT
+// of them, IF takes no ELSE/ELIF, and RETURN must end its block outside any
+// loop, with the body ending in a RETURN (the interpreter finishes the
+// enclosing blocks and loops after a RETURN).
+class FunctionLowering {
+public:
+    struct Lowered {
+        std::string name;
+        size_t body_start;  // Token index the interpreter registers it under
+        std::string entry;  // C++ NativeFunction
+    };
+
+    explicit FunctionLowering(const std::vector<Token>& program) : tokens(program) {}
+
+    // C++ definitions of the functions that could be lowered, which are
+    // listed in `lowered`
+    std::string lower(std::vector<Lowered>& lowered) {
+        find_candidates();
+        std::string code;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            Candidate& candidate = candidates[i];
+            std::string definition;
+            if (!lower_function(candidate, definition)) {
+                continue;
+            }
+            candidate.lowered = true;
+            code += definition;
+            lowered.push_back({candidate.name, candidate.body_start, entry_name(candidate)});
+        }
+        return code;
+    }
+
+private:
+    struct Candidate {
+        std::string name;
+        std::vector<std::string> params;
+        size_t body_start;
+        size_t body_end;  // The closing END
+        size_t index;
+        int line;
+        bool lowered = false;
+    };
+
+    struct Expr {
+        std::string code;
+        bool is_bool = false;
+        bool can_fail = false;  // Division, modulo or a call: check `ok` after it
+        const Candidate* call = nullptr;  // The whole expression is this call
+        std::vector<std::string> args;    // ... with these arguments
+    };
+
+    // Bails out of a lowered function; the interpreter reruns the call
+    static constexpr const char* FAILED = "return NativeNumber();";
+
+    const std::vector<Token>& tokens;
+    std::vector<Candidate> candidates;
+
+    // State of the function being lowered
+    const Candidate* function = nullptr;
+    size_t pos = 0;
+    size_t limit = 0;
+    std::map<std::string, size_t> slots;  // Parameters and locals
+    std::set<std::string> assigned;       // Names assigned on every path so far
+    std::string indent;
+    size_t temporaries = 0;
+    bool self_tail_call = false;
+
+    TokenType type_at(size_t offset = 0) const {
+        return pos + offset < limit ? tokens[pos + offset].type : TokenType::EOF_TOKEN;
+    }
+
+    bool block_start_at(size_t at) const {
+        return at + 1 < tokens.size() && tokens[at].type == TokenType::START &&
+               tokens[at + 1].type == TokenType::COLON;
+    }
+
+    bool block_end_at(size_t at) const {
+        return at + 1 < tokens.size() && tokens[at].type == TokenType::END &&
+               tokens[at + 1].type == TokenType::COLON;
+    }
+
+    // The END: closing the block whose body starts at `at`, or tokens.size()
+    size_t find_block_end(size_t at) const {
+        int depth = 1;
+        for (; at < tokens.size() && tokens[at].type != TokenType::EOF_TOKEN; at++) {
+            if (block_start_at(at)) {
+                depth++;
+            } else if (block_end_at(at) && --depth == 0) {
+                return at;
+            }
+        }
+        return tokens.size();
+    }
+
+    size_t skip_newlines(size_t at) const {
+        while (at < tokens.size() && tokens[at].type == TokenType::NEWLINE) {
+            at++;
+        }
+        return at;
+    }
+
+    static std::string entry_name(const Candidate& candidate) {
+        return "call_" + std::to_string(candidate.index);
+    }
+
+    static std::string function_name(const Candidate& candidate) {
+        return "lowered_" + std::to_string(candidate.index);
+    }
+
+    // FUNC name(a, b): START: at the top level, for names defined once and
+    // only ever called (never assigned, passed or shadowed)
+    void find_candidates() {
+        std::map<std::string, int> definitions;
+        std::set<std::string> not_called;
+        for (size_t i = 0; i < tokens.size(); i++) {
+            if (tokens[i].type != TokenType::IDENTIFIER) {
+                continue;
+            }
+            TokenType prev = i > 0 ? tokens[i - 1].type : TokenType::NEWLINE;
+            TokenType next = i + 1 < tokens.size() ? tokens[i + 1].type : TokenType::EOF_TOKEN;
+            if (prev == TokenType::FUNC) {
+                definitions[tokens[i].value]++;
+            } else if (prev != TokenType::DOT && next != TokenType::LPAREN) {
+                not_called.insert(tokens[i].value);
+            }
+        }
+
+        int depth = 0;
+        for (size_t i = 0; i + 2 < tokens.size(); i++) {
+            if (block_start_at(i)) {
+                depth++;
+            } else if (block_end_at(i)) {
+                depth--;
+            }
+            bool statement_start = i == 0 || tokens[i - 1].type == TokenType::NEWLINE;
+            if (depth != 0 || tokens[i].type != TokenType::FUNC || !statement_start ||
+                tokens[i + 1].type != TokenType::IDENTIFIER || tokens[i + 2].type != TokenType::LPAREN) {
+                continue;
+            }
+            Candidate candidate;
+            candidate.name = tokens[i + 1].value;
+            candidate.line = tokens[i].line;
+            if (definitions[candidate.name] != 1 || not_called.count(candidate.name)) {
+                continue;
+            }
+            size_t at = i + 3;
+            while (tokens[at].type == TokenType::IDENTIFIER) {
+                if (std::find(candidate.params.begin(), candidate.params.end(), tokens[at].value) !=
+                    candidate.params.end()) {
+                    break;
+                }
+                candidate.params.push_back(tokens[at].value);
+                at++;
+                if (tokens[at].type != TokenType::COMMA) {
+                    break;
+                }
+                at++;
+            }
+            if (tokens[at].type != TokenType::RPAREN || tokens[at + 1].type != TokenType::COLON) {
+                continue;
+            }
+            at = skip_newlines(at + 2);
+            if (!block_start_at(at)) {
+                continue;
+            }
+            candidate.body_start = skip_newlines(at + 2);
+            candidate.body_end = find_block_end(candidate.body_start);
+            if (candidate.body_end == tokens.size()) {
+                continue;
+            }
+            candidate.index = candidates.size();
+            candidates.push_back(std::move(candidate));
+        }
+    }
+
+    const Candidate* callee(const std::string& name) const {
+        if (name == function->name) {
+            return function;
+        }
+        for (const Candidate& candidate : candidates) {
+            if (&candidate == function) {
+                break;  // Only functions defined (and so lowered) earlier
+            }
+            if (candidate.lowered && candidate.name == name) {
+                return &candidate;
+            }
+        }
+        return nullptr;
+    }
+
+    bool lower_function(const Candidate& candidate, std::string& definition) {
+        function = &candidate;
+        pos = candidate.body_start;
+        limit = candidate.body_end;
+        slots.clear();
+        assigned.clear();
+        temporaries = 0;
+        self_tail_call = false;
+        for (const std::string& param : candidate.params) {
+            slots.emplace(param, slots.size());
+            assigned.insert(param);
+        }
+
+        std::ostringstream body;
+        bool returns = false;
+        indent = "        ";
+        if (!lower_block(body, limit, false, true, returns)) {
+            return false;
+        }
+
+        std::ostringstream out;
+        out << "// " << candidate.name << "(";
+        for (size_t i = 0; i < candidate.params.size(); i++) {
+            out << (i > 0 ? ", " : "") << candidate.params[i];
+        }
+        out << "), line " << candidate.line << "\n"
+            << "NativeNumber " << function_name(candidate) << "(";
+        for (size_t i = 0; i < candidate.params.size(); i++) {
+            out << "NativeNumber v" << i << ", ";
+        }
+        out << "size_t depth, bool& ok) {\n"
+            << "    if (depth == 0 || !ok) {\n"
+            << "        ok = false;\n"
+            << "        return NativeNumber();\n"
+            << "    }\n";
+        for (size_t i = candidate.params.size(); i < slots.size(); i++) {
+            out << "    NativeNumber v" << i << ";\n";
+        }
+        if (self_tail_call) {
+            out << "    for (;;) {\n" << body.str() << "    }\n";
+        } else {
+            // Statements were indented for the tail call loop
+            std::istringstream lines(body.str());
+            std::string line;
+            while (std::getline(lines, line)) {
+                out << line.substr(line.empty() ? 0 : 4) << "\n";
+            }
+        }
+        out << "}\n\n"
+            << "bool " << entry_name(candidate)
+            << "(const susa::ValuePtr* args, size_t argc, size_t depth, susa::ValuePtr& result) {\n"
+            << "    NativeNumber a[" << std::max<size_t>(candidate.params.size(), 1) << "];\n"
+            << "    if (argc != " << candidate.params.size() << ") {\n"
+            << "        return false;\n"
+            << "    }\n"
+            << "    for (size_t i = 0; i < argc; i++) {\n"
+            << "        if (!NativeNumber::from_value(args[i], a[i])) {\n"
+            << "            return false;\n"
+            << "        }\n"
+            << "    }\n"
+            << "    bool ok = true;\n"
+            << "    NativeNumber value = " << function_name(candidate) << "(";
+        for (size_t i = 0; i < candidate.params.size(); i++) {
+            out << "a[" << i << "], ";
+        }
+        out << "depth, ok);\n"
+            << "    if (!ok) {\n"
+            << "        return false;\n"
+            << "    }\n"
+            << "    result = value.to_value();\n"
+            << "    return true;\n"
+            << "}\n\n";
+        definition = out.str();
+        return true;
+    }
+
+    // Statements up to `end`. A block holding a RETURN must end with it,
+    // except the function body, which must end with a RETURN statement.
+    bool lower_block(std::ostream& out, size_t end, bool in_loop, bool is_body, bool& returns) {
+        std::set<std::string> outer_assigned = assigned;
+        returns = false;
+        bool ends_with_return = false;
+        pos = skip_newlines(pos);
+        while (pos < end) {
+            bool statement_returns = false;
+            ends_with_return = type_at() == TokenType::RETURN;
+            if (!lower_statement(out, in_loop, statement_returns)) {
+                return false;
+            }
+            pos = skip_newlines(pos);
+            if (statement_returns) {
+                returns = true;
+                if (!is_body && pos != end) {
+                    return false;
+                }
+            }
+        }
+        if (!is_body) {
+            assigned.swap(outer_assigned);
+        }
+        return pos == end && (!is_body || ends_with_return);
+    }
+
+    bool statement_end() const {
+        return type_at() == TokenType::NEWLINE || pos == limit;
+    }
+
+    bool lower_statement(std::ostream& out, bool in_loop, bool& returns) {
+        switch (type_at()) {
+            case TokenType::LET:
+                if (type_at(1) != TokenType::IDENTIFIER || type_at(2) != TokenType::ASSIGN) {
+                    return false;
+                }
+                pos++;
+                return lower_assignment(out);
+            case TokenType::IDENTIFIER:
+                return lower_assignment(out);
+            case TokenType::IF:
+                return lower_if(out, in_loop, returns);
+            case TokenType::WHILE:
+                return lower_while(out);
+            case TokenType::LOOP:
+                if (type_at(1) == TokenType::WHILE) {
+                    pos++;
+                    return lower_while(out);
+                }
+                return lower_loop_times(out);
+            case TokenType::BREAK:
+            case TokenType::CONTINUE:
+                if (!in_loop) {
+                    return false;
+                }
+                out << indent << (type_at() == TokenType::BREAK ? "break;" : "continue;") << "\n";
+                pos++;
+                return statement_end();
+            case TokenType::RETURN:
+                if (in_loop) {
+                    return false;
+                }
+                returns = true;
+                return lower_return(out);
+            default:
+                return false;
+        }
+    }
+
+    void check_ok(std::ostream& out, const Expr& expr) {
+        if (expr.can_fail) {
+            out << indent << "if (!ok) " << FAILED << "\n";
+        }
+    }
+
+    size_t slot_for(const std::string& name) {
+        auto it = slots.find(name);
+        if (it == slots.end()) {
+            it = slots.emplace(name, slots.size()).first;
+        }
+        return it->second;
+    }
+
+    std::string variable(const std::string& name) const {
+        return "v" + std::to_string(slots.at(name));
+    }
+
+    // name = / op= / ++ / --
+    bool lower_assignment(std::ostream& out) {
+        const std::string& name = tokens[pos].value;
+        TokenType op = type_at(1);
+        pos += 2;
+
+        Expr value;
+        if (op == TokenType::ASSIGN) {
+            if (!lower_or(value)) {
+                return false;
+            }
+        } else {
+            if (!assigned.count(name)) {
+                return false;
+            }
+            Expr right;
+            const char* operation = nullptr;
+            switch (op) {
+                case TokenType::INCREMENT:
+                case TokenType::DECREMENT:
+                    right.code = "NativeNumber::of(int64_t(1))";
+                    operation = op == TokenType::INCREMENT ? "add" : "subtract";
+                    break;
+                case TokenType::PLUS_ASSIGN: operation = "add"; break;
+                case TokenType::MINUS_ASSIGN: operation = "subtract"; break;
+                case TokenType::MULT_ASSIGN: operation = "multiply"; break;
+                case TokenType::DIV_ASSIGN: operation = "divide"; break;
+                case TokenType::MOD_ASSIGN: operation = "modulo"; break;
+                case TokenType::POW_ASSIGN: operation = "power"; break;
+                default: return false;
+            }
+            if (right.code.empty() && !lower_or(right)) {
+                return false;
+            }
+            Expr left;
+            left.code = variable(name);
+            if (!arithmetic(operation, left, right, value)) {
+                return false;
+            }
+        }
+        if (value.is_bool || !statement_end()) {
+            return false;
+        }
+        slot_for(name);
+        assigned.insert(name);
+        out << indent << variable(name) << " = " << value.code << ";\n";
+        check_ok(out, value);
+        return true;
+    }
+
+    // IF condition: START: ... END: (without ELSE/ELIF)
+    bool lower_if(std::ostream& out, bool in_loop, bool& returns) {
+        pos++;
+        Expr condition;
+        if (!lower_or(condition) || !condition.is_bool) {
+            return false;
+        }
+        size_t block_end;
+        if (!enter_block(block_end)) {
+            return false;
+        }
+        size_t after = skip_newlines(block_end + 2);
+        if (after < tokens.size() &&
+            (tokens[after].type == TokenType::ELSE || tokens[after].type == TokenType::ELIF)) {
+            return false;
+        }
+
+        std::string test = condition_code(out, condition);
+        out << indent << "if (" << test << ") {\n";
+        indent += "    ";
+        if (!lower_block(out, block_end, in_loop, false, returns)) {
+            return false;
+        }
+        indent.resize(indent.size() - 4);
+        out << indent << "}\n";
+        pos = block_end + 2;
+        return true;
+    }
+
+    // WHILE / LOOP WHILE condition: START: ... END:
+    bool lower_while(std::ostream& out) {
+        pos++;
+        Expr condition;
+        if (!lower_or(condition) || !condition.is_bool) {
+            return false;
+        }
+        size_t block_end;
+        if (!enter_block(block_end)) {
+            return false;
+        }
+        if (condition.can_fail) {
+            std::string test = "c" + std::to_string(temporaries++);
+            out << indent << "for (;;) {\n";
+            indent += "    ";
+            out << indent << "bool " << test << " = " << condition.code << ";\n";
+            check_ok(out, condition);
+            out << indent << "if (!" << test << ") break;\n";
+        } else {
+            out << indent << "while (" << condition.code << ") {\n";
+            indent += "    ";
+        }
+        bool returns = false;
+        if (!lower_block(out, block_end, true, false, returns)) {
+            return false;
+        }
+        indent.resize(indent.size() - 4);
+        out << indent << "}\n";
+        pos = block_end + 2;
+        return true;
+    }
+
+    // LOOP [counter [= first]] FOR n TIMES: START: ... END:
+    bool lower_loop_times(std::ostream& out) {
+        pos++;
+        std::string counter;
+        double first = 1;
+        if (type_at() == TokenType::IDENTIFIER) {
+            counter = tokens[pos++].value;
+            if (type_at() == TokenType::ASSIGN) {
+                if (type_at(1) != TokenType::NUMBER || !parse_number(tokens[pos + 1].value, first)) {
+                    return false;
+                }
+                pos += 2;
+            }
+        }
+        double iterations = 0;
+        if (type_at() != TokenType::FOR || type_at(1) != TokenType::NUMBER ||
+            !parse_number(tokens[pos + 1].value, iterations) || type_at(2) != TokenType::TIMES) {
+            return false;
+        }
+        pos += 3;
+        // The interpreter counts in int
+        const double int_max = std::numeric_limits<int>::max();
+        if (!(first >= -int_max && first <= int_max && iterations >= -int_max && iterations <= int_max)) {
+            return false;
+        }
+        int64_t start = static_cast<int>(first);
+        int64_t count = static_cast<int>(iterations);
+        if (count > 0 && start + count - 1 > int_max) {
+            return false;
+        }
+        size_t block_end;
+        if (!enter_block(block_end)) {
+            return false;
+        }
+
+        std::string index = "n" + std::to_string(temporaries++);
+        out << indent << "for (int64_t " << index << " = 0; " << index << " < " << count << "; " << index
+            << "++) {\n";
+        indent += "    ";
+        std::set<std::string> outer_assigned = assigned;
+        if (!counter.empty()) {
+            slot_for(counter);
+            assigned.insert(counter);
+            out << indent << variable(counter) << " = NativeNumber::of(int64_t(" << start << " + " << index
+                << "));\n";
+        }
+        bool returns = false;
+        if (!lower_block(out, block_end, true, false, returns)) {
+            return false;
+        }
+        assigned.swap(outer_assigned);
+        indent.resize(indent.size() - 4);
+        out << indent << "}\n";
+        pos = block_end + 2;
+        return true;
+    }
+
+    // `: START:` after a header; leaves pos at the first statement and
+    // `block_end` at the closing END
+    bool enter_block(size_t& block_end) {
+        if (type_at() != TokenType::COLON) {
+            return false;
+        }
+        pos = skip_newlines(pos + 1);
+        if (pos >= limit || !block_start_at(pos)) {
+            return false;
+        }
+        pos += 2;
+        block_end = find_block_end(pos);
+        return block_end < limit;
+    }
+
+    std::string condition_code(std::ostream& out, const Expr& condition) {
+        if (!condition.can_fail) {
+            return condition.code;
+        }
+        std::string test = "c" + std::to_string(temporaries++);
+        out << indent << "bool " << test << " = " << condition.code << ";\n";
+        check_ok(out, condition);
+        return test;
+    }
+
+    bool lower_return(std::ostream& out) {
+        pos++;
+        Expr value;
+        if (!lower_or(value) || value.is_bool || !statement_end()) {
+            return false;
+        }
+        if (value.call != function) {
+            out << indent << "return " << value.code << ";\n";
+            return true;
+        }
+        // RETURN f(...) to this function: rebind the parameters and start over
+        self_tail_call = true;
+        std::vector<std::string> temps;
+        for (const std::string& arg : value.args) {
+            temps.push_back("t" + std::to_string(temporaries++));
+            out << indent << "NativeNumber " << temps.back() << " = " << arg << ";\n";
+        }
+        out << indent << "if (!ok) " << FAILED << "\n";
+        for (size_t i = 0; i < temps.size(); i++) {
+            out << indent << "v" << i << " = " << temps[i] << ";\n";
+        }
+        out << indent << "continue;\n";
+        return true;
+    }
+
+    // Expressions, with the interpreter's precedence. AND/OR/NOT take
+    // comparisons (or each other); everything else takes numbers.
+
+    bool lower_or(Expr& out) {
+        if (!lower_and(out)) {
+            return false;
+        }
+        while (type_at() == TokenType::OR) {
+            pos++;
+            Expr right;
+            if (!lower_and(right) || !logical("either", out, right)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool lower_and(Expr& out) {
+        if (!lower_not(out)) {
+            return false;
+        }
+        while (type_at() == TokenType::AND) {
+            pos++;
+            Expr right;
+            if (!lower_not(right) || !logical("both", out, right)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool logical(const char* operation, Expr& left, const Expr& right) {
+        if (!left.is_bool || !right.is_bool) {
+            return false;
+        }
+        left.code = std::string("NativeNumber::") + operation + "(" + left.code + ", " + right.code + ")";
+        left.can_fail = left.can_fail || right.can_fail;
+        left.call = nullptr;
+        return true;
+    }
+
+    bool lower_not(Expr& out) {
+        if (type_at() != TokenType::NOT) {
+            return lower_comparison(out);
+        }
+        pos++;
+        if (!lower_not(out) || !out.is_bool) {
+            return false;
+        }
+        out.code = "!" + out.code;
+        return true;
+    }
+
+    bool lower_comparison(Expr& out) {
+        if (!lower_addition(out)) {
+            return false;
+        }
+        while (true) {
+            const char* compare;
+            switch (type_at()) {
+                case TokenType::EQUAL: compare = "std::equal_to<>()"; break;
+                case TokenType::NOT_EQUAL: compare = "std::not_equal_to<>()"; break;
+                case TokenType::LESS: compare = "std::less<>()"; break;
+                case TokenType::GREATER: compare = "std::greater<>()"; break;
+                case TokenType::LESS_EQUAL: compare = "std::less_equal<>()"; break;
+                case TokenType::GREATER_EQUAL: compare = "std::greater_equal<>()"; break;
+                default: return true;
+            }
+            pos++;
+            Expr right;
+            if (!lower_addition(right) || out.is_bool || right.is_bool) {
+                return false;
+            }
+            out.code = "NativeNumber::compare(" + out.code + ", " + right.code + ", " + compare + ")";
+            out.is_bool = true;
+            out.can_fail = out.can_fail || right.can_fail;
+            out.call = nullptr;
+        }
+    }
+
+    static bool arithmetic(const char* operation, const Expr& left, const Expr& right, Expr& out) {
+        if (left.is_bool || right.is_bool) {
+            return false;
+        }
+        bool checked = std::strcmp(operation, "divide") == 0 || std::strcmp(operation, "modulo") == 0;
+        out.code = std::string("NativeNumber::") + operation + "(" + left.code + ", " + right.code +
+                   (checked ? ", ok)" : ")");
+        out.is_bool = false;
+        out.can_fail = checked || left.can_fail || right.can_fail;
+        out.call = nullptr;
+        return true;
+    }
+
+    bool lower_addition(Expr& out) {
+        if (!lower_multiplication(out)) {
+            return false;
+        }
+        while (type_at() == TokenType::PLUS || type_at() == TokenType::MINUS) {
+            const char* operation = type_at() == TokenType::PLUS ? "add" : "subtract";
+            pos++;
+            Expr right;
+            Expr left = std::move(out);
+            if (!lower_multiplication(right) || !arithmetic(operation, left, right, out)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool lower_multiplication(Expr& out) {
+        if (!lower_power(out)) {
+            return false;
+        }
+        while (type_at() == TokenType::MULTIPLY || type_at() == TokenType::DIVIDE ||
+               type_at() == TokenType::MODULO) {
+            const char* operation = type_at() == TokenType::MULTIPLY ? "multiply"
+                                    : type_at() == TokenType::DIVIDE ? "divide" : "modulo";
+            pos++;
+            Expr right;
+            Expr left = std::move(out);
+            if (!lower_power(right) || !arithmetic(operation, left, right, out)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Right-associative, below unary minus (-2 ** 2 is 4)
+    bool lower_power(Expr& out) {
+        if (!lower_unary(out)) {
+            return false;
+        }
+        if (type_at() != TokenType::POWER) {
+            return true;
+        }
+        pos++;
+        Expr right;
+        Expr left = std::move(out);
+        return lower_power(right) && arithmetic("power", left, right, out);
+    }
+
+    bool lower_unary(Expr& out) {
+        if (type_at() != TokenType::MINUS) {
+            return lower_primary(out);
+        }
+        pos++;
+        if (!lower_unary(out) || out.is_bool) {
+            return false;
+        }
+        out.code = "NativeNumber::negate(" + out.code + ")";
+        out.call = nullptr;
+        return true;
+    }
+
+    bool lower_primary(Expr& out) {
+        TokenType type = type_at();
+        if (type == TokenType::NUMBER) {
+            return number_literal(tokens[pos++].value, out);
+        }
+        if (type == TokenType::TRUE || type == TokenType::FALSE) {
+            pos++;
+            out.code = type == TokenType::TRUE ? "true" : "false";
+            out.is_bool = true;
+            return true;
+        }
+        if (type == TokenType::LPAREN) {
+            pos++;
+            if (!lower_or(out) || type_at() != TokenType::RPAREN) {
+                return false;
+            }
+            pos++;
+            out.code = "(" + out.code + ")";
+            out.call = nullptr;  // (f(x)) is not a tail call
+            return true;
+        }
+        if (type != TokenType::IDENTIFIER) {
+            return false;
+        }
+        const std::string& name = tokens[pos].value;
+        TokenType next = type_at(1);
+        if (next == TokenType::LPAREN) {
+            return lower_call(out);
+        }
+        if (next == TokenType::LBRACKET || next == TokenType::DOT || !assigned.count(name)) {
+            return false;
+        }
+        pos++;
+        out.code = variable(name);
+        return true;
+    }
+
+    static bool number_literal(const std::string& text, Expr& out) {
+        int64_t int_value;
+        if (parse_integer(text, int_value)) {
+            out.code = "NativeNumber::of(int64_t(" + std::to_string(int_value) + "))";
+            return true;
+        }
+        double value;
+        if (!parse_number(text, value) || !std::isfinite(value)) {
+            return false;
+        }
+        char hex[64];
+        std::snprintf(hex, sizeof(hex), "%a", value);  // Exact
+        out.code = std::string("NativeNumber::of(") + hex + ")";
+        return true;
+    }
+
+    bool lower_call(Expr& out) {
+        const Candidate* target = callee(tokens[pos].value);
+        if (target == nullptr) {
+            return false;
+        }
+        pos += 2;  // Name and (
+        std::vector<std::string> args;
+        while (type_at() != TokenType::RPAREN) {
+            Expr arg;
+            if (!lower_or(arg) || arg.is_bool) {
+                return false;
+            }
+            args.push_back(arg.code);
+            if (type_at() == TokenType::COMMA) {
+                pos++;
+            } else if (type_at() != TokenType::RPAREN) {
+                return false;
+            }
+        }
+        pos++;
+        // Other arities raise in the interpreter
+        if (args.size() != target->params.size()) {
+            return false;
+        }
+        out.code = function_name(*target) + "(";
+        for (const std::string& arg : args) {
+            out.code += arg + ", ";
+        }
+        out.code += "depth - 1, ok)";
+        out.is_bool = false;
+        out.can_fail = true;
+        out.call = target;
+        out.args = std::move(args);
+        return true;
+    }
+};
+
+// Ahead-of-time build: `susa build script.susa -o app`.
+//
+// The script is lexed and optimized at build time and written out as a C++
+// translation unit holding the resulting token stream (plus the source, for
+// error context), C++ versions of the functions FunctionLowering can lower,
+// and a main() that registers those and hands the tokens to the runtime. The
+// system compiler then turns that into a standalone executable linked
+// against the header-only runtime. Lowered functions run as compiled C++;
+// everything else is interpreted (including the loop JIT), which covers
+// every dynamic feature.
+struct BuildOptions {
+    std::string script;
+    std::string output;
+    std::string runtime_dir;  // Directory holding susa_interpreter_v2.hpp
+    std::string compiler;     // C++ compiler command
+    std::string cpp_output;   // Where to keep the generated C++ (empty: temporary)
+    size_t max_depth = 0;     // 0 keeps the runtime default
+    bool inline_functions = true;
+    bool jit = true;
+    bool lower_functions = true;
+};
+
+class ProgramBuilder {
+public:
+    explicit ProgramBuilder(BuildOptions build_options) : options(std::move(build_options)) {}
+
+    // Generate, compile and link; returns a process exit code and reports
+    // problems on stderr
+    int build() {
+        std::string source;
+        if (!read_source(source)) {
+            return 1;
+        }
+
+        std::vector<Token> program;
+        try {
+            Interpreter interpreter;
+            interpreter.set_inline(options.inline_functions);
+            program = interpreter.compile(source);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "Error: %s\n", e.what());
+            return 1;
+        }
+
+        bool keep_cpp = !options.cpp_output.empty();
+        std::string cpp_path = keep_cpp ? options.cpp_output : options.output + ".susa.cpp";
+        {
+            std::ofstream out(cpp_path);
+            if (!out.is_open()) {
+                std::fprintf(stderr, "Error: Could not write %s\n", cpp_path.c_str());
+                return 1;
+            }
+            out << generate(source, program);
+        }
+
+        std::string command = options.compiler + " -std=c++17 -O2 -I" + shell_quote(options.runtime_dir) +
+                              " " + shell_quote(cpp_path) + " -o " + shell_quote(options.output);
+        int status = std::system(command.c_str());
+        if (!keep_cpp) {
+            std::remove(cpp_path.c_str());
+        }
+        if (status != 0) {
+            std::fprintf(stderr, "Error: C++ compilation failed: %s\n", command.c_str());
+            return 1;
+        }
+        return 0;
+    }
+
+    // C++ source of the standalone program
+    std::string generate(const std::string& source, const std::vector<Token>& program) const {
+        std::vector<FunctionLowering::Lowered> lowered;
+        std::string lowered_code;
+        if (options.lower_functions) {
+            lowered_code = FunctionLowering(program).lower(lowered);
+        }
+
+        std::ostringstream out;
+        out << "// Generated by `susa build` from " << options.script << "; do not edit.\n"
+            << "// Token types are numbered as in the susa_lexer.hpp it was built against.\n"
+            << "#include \"susa_interpreter_v2.hpp\"\n"
+            << "#include \"susa_native.hpp\"\n"
+            << "#include <iostream>\n\n"
+            << "namespace {\n\n"
+            << "const char program_source[] = " << cpp_string(source) << ";\n\n"
+            << "struct ProgramToken {\n"
+            << "    int type;\n"
+            << "    const char* value;\n"
+            << "    int line;\n"
+            << "    int column;\n"
+            << "};\n\n"
+            << "const ProgramToken program_tokens[] = {\n";
+        for (const Token& token : program) {
+            out << "    {" << static_cast<int>(token.type) << ", " << cpp_string(token.value) << ", "
+                << token.line << ", " << token.column << "},\n";
+        }
+        out << "};\n\n";
+        if (!lowered.empty()) {
+            out << "using susa::NativeNumber;\n\n" << lowered_code;
+        }
+        out << "}  // namespace\n\n"
+            << "int main() {\n"
+            << "    std::vector<susa::Token> tokens;\n"
+            << "    tokens.reserve(sizeof(program_tokens) / sizeof(program_tokens[0]));\n"
+            << "    for (const ProgramToken& token : program_tokens) {\n"
+            << "        tokens.emplace_back(static_cast<susa::TokenType>(token.type), token.value,\n"
+            << "                            token.line, token.column);\n"
+            << "    }\n\n"
+            << "    susa::Interpreter::raise_stack_limit();\n"
+            << "    susa::Interpreter interpreter;\n";
+        if (options.max_depth > 0) {
+            out << "    interpreter.set_max_call_depth(" << options.max_depth << ");\n";
+        }
+        if (!options.jit) {
+            out << "    interpreter.set_jit(false);\n";
+        }
+        for (const auto& function : lowered) {
+            out << "    interpreter.register_native(" << cpp_string(function.name) << ", " << function.body_start
+                << ", " << function.entry << ");\n";
+        }
+        out << "    std::cout << interpreter.execute_compiled(program_source, std::move(tokens));\n"
+            << "    return 0;\n"
+            << "}\n";
+        return out.str();
+    }
+
+private:
+    BuildOptions options;
+
+    bool read_source(std::string& source) const {
+        std::ifstream file(options.script);
+        if (!file.is_open()) {
+            std::fprintf(stderr, "Error: Could not open file: %s\n", options.script.c_str());
+            return false;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        source = buffer.str();
+        return true;
+    }
+
+    // C++ string literal; octal escapes can't swallow following digits the
+    // way \x escapes do
+    static std::string cpp_string(const std::string& text) {
+        std::string literal = "\"";
+        for (unsigned char c : text) {
+            switch (c) {
+                case '"': literal += "\\\""; break;
+                case '\\': literal += "\\\\"; break;
+                case '\n': literal += "\\n\"\n    \""; break;
+                case '\t': literal += "\\t"; break;
+                case '?': literal += "\\?"; break;  // No trigraphs
+                default:
+                    if (c < 0x20 || c >= 0x7F) {
+                        char escaped[5];
+                        std::snprintf(escaped, sizeof(escaped), "\\%03o", c);
+                        literal += escaped;
+                    } else {
+                        literal += static_cast<char>(c);
+                    }
+            }
+        }
+        return literal + "\"";
+    }
+
+    static std::string shell_quote(const std::string& text) {
+#ifdef _WIN32
+        return "\"" + text + "\"";
+#else
+        std::string quoted = "'";
+        for (char c : text) {
+            if (c == '\'') {
+                quoted += "'\\''";
+            } else {
+                quoted += c;
+            }
+        }
+        return quoted + "'";
+#endif
+    }
+};
+
+}  // namespace susa
+
+#endif  // SUSA_BUILD_HPP
@@ -18,7 +18,10 @@ enum class ErrorType {
     VALUE_ERROR,       // Invalid value for operation
     ZERO_DIVISION_ERROR, // Division by zero
     KEY_ERROR,         // Dictionary key not found
-    ARGUMENT_ERROR     // Wrong number of arguments
+    ARGUMENT_ERROR,    // Wrong number of arguments
+    RECURSION_ERROR,   // Call depth limit exceeded
+    BUDGET_ERROR,      // Execution budget (instructions, time) used up
+    MEMORY_ERROR       // Memory limit reached or allocation failed
 };
 
 class SUSAError {
@@ -47,6 +50,9 @@ public:
             case ErrorType::ZERO_DIVISION_ERROR: return "ZeroDivisionError";
             case ErrorType::KEY_ERROR: return "KeyError";
             case ErrorType::ARGUMENT_ERROR: return "ArgumentError";
+            case ErrorType::RECURSION_ERROR: return "RecursionError";
+            case ErrorType::BUDGET_ERROR: return "BudgetError";
+            case ErrorType::MEMORY_ERROR: return "MemoryError";
             default: return "Error";
         }
     }
@@ -0,0 +1,285 @@
+#ifndef SUSA_HEAP_HPP
+#define SUSA_HEAP_HPP
+
+#include "susa_value.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace susa {
+
+// Heap introspection behind the `runtime` module and SUSA_HEAP_DUMP.
+//
+// SUSA values are reference counted, so there is no heap to scan: sizes
+// and reachability are computed by walking from the roots the interpreter
+// hands in, each distinct Value counted once. Byte figures are estimates
+// (the Value with its shared_ptr control block plus the buffers it owns).
+// collect_cycles() is the one thing reference counting cannot do by
+// itself: it frees containers that only keep each other alive.
+class HeapWalker {
+public:
+    struct Summary {
+        size_t values = 0;
+        size_t bytes = 0;
+        size_t string_bytes = 0;   // Character data of STRING values
+        size_t list_capacity = 0;  // Element slots allocated by LIST values
+        size_t dict_capacity = 0;  // Hash slots allocated by DICT values
+        size_t by_type[ValueCounters::TYPE_COUNT] = {};
+    };
+
+    // Approximate bytes owned by one Value, not counting the values it refers to
+    static size_t shallow_bytes(const Value& value) {
+        size_t bytes = sizeof(Value) + 2 * sizeof(void*);  // make_shared control block
+        bytes += string_bytes(value.string_value) + string_bytes(value.lambda_body) +
+                 string_bytes(value.class_name);
+        bytes += value.lambda_params.capacity() * sizeof(std::string);
+        for (const std::string& param : value.lambda_params) {
+            bytes += string_bytes(param);
+        }
+        bytes += value.list_value.capacity() * sizeof(ValuePtr);
+        bytes += value.dict_value.heap_bytes();
+        bytes += value.instance_slots.capacity() * sizeof(ValuePtr);
+        bytes += value.generator_values.capacity() * sizeof(ValuePtr);
+        return bytes;
+    }
+
+    template <typename F>
+    static void for_each_child(const Value& value, F visit) {
+        for (const ValuePtr& item : value.list_value) {
+            visit(item);
+        }
+        for (const auto& entry : value.dict_value.items()) {
+            visit(entry.key);
+            visit(entry.value);
+        }
+        for (const ValuePtr& slot : value.instance_slots) {
+            visit(slot);
+        }
+        for (const ValuePtr& item : value.generator_values) {
+            visit(item);
+        }
+    }
+
+    // Add everything reachable from `root` that has not been seen yet;
+    // returns the bytes added
+    size_t visit(const ValuePtr& root) {
+        size_t added = 0;
+        if (root == nullptr || !seen.insert(root.get()).second) {
+            return 0;
+        }
+        pending.push_back(root.get());
+        while (!pending.empty()) {
+            const Value* value = pending.back();
+            pending.pop_back();
+            size_t bytes = shallow_bytes(*value);
+            added += bytes;
+            summary.values++;
+            summary.bytes += bytes;
+            summary.by_type[static_cast<size_t>(value->type)]++;
+            if (value->type == ValueType::STRING) {
+                summary.string_bytes += value->string_value.size();
+            }
+            summary.list_capacity += value->list_value.capacity();
+            summary.dict_capacity += value->dict_value.capacity();
+            for_each_child(*value, [this](const ValuePtr& child) {
+                if (child != nullptr && seen.insert(child.get()).second) {
+                    pending.push_back(child.get());
+                }
+            });
+        }
+        return added;
+    }
+
+    const Summary& totals() const {
+        return summary;
+    }
+
+    // Deep size of one value: it and everything it refers to, each once
+    static size_t deep_bytes(const ValuePtr& root) {
+        HeapWalker walker;
+        return walker.visit(root);
+    }
+
+    // Free LIST / DICT / INSTANCE / GENERATOR values kept alive only by
+    // references from other containers (cycles the reference counts never
+    // release). Every reference from outside the containers (variables,
+    // call frames, interpreter state) counts as a root. Returns the number
+    // of Values freed.
+    static size_t collect_cycles() {
+        struct Node {
+            long internal = 0;   // References from other containers
+            long use_count = 0;  // All references, seen through one of them
+            bool reachable = false;
+            ValuePtr handle;     // Keeps a candidate alive while it is cleared
+        };
+        std::unordered_map<Value*, Node> nodes;
+        for (Value* value = Value::first_container(); value != nullptr; value = value->next_container()) {
+            nodes[value];
+        }
+        for (auto& node : nodes) {
+            for_each_child(*node.first, [&nodes](const ValuePtr& child) {
+                auto it = child != nullptr ? nodes.find(child.get()) : nodes.end();
+                if (it == nodes.end()) {
+                    return;
+                }
+                if (it->second.handle == nullptr) {
+                    it->second.use_count = child.use_count();
+                    it->second.handle = child;
+                }
+                it->second.internal++;
+            });
+        }
+
+        // Containers with outside references, and all they reach, stay
+        std::vector<Value*> pending;
+        for (auto& node : nodes) {
+            if (node.second.handle == nullptr || node.second.use_count > node.second.internal) {
+                node.second.reachable = true;
+                pending.push_back(node.first);
+            }
+        }
+        while (!pending.empty()) {
+            Value* value = pending.back();
+            pending.pop_back();
+            for_each_child(*value, [&nodes, &pending](const ValuePtr& child) {
+                auto it = child != nullptr ? nodes.find(child.get()) : nodes.end();
+                if (it != nodes.end() && !it->second.reachable) {
+                    it->second.reachable = true;
+                    pending.push_back(it->first);
+                }
+            });
+        }
+
+        int64_t live_before = live_values();
+        std::vector<ValuePtr> garbage;
+        for (auto& node : nodes) {
+            if (!node.second.reachable) {
+                garbage.push_back(std::move(node.second.handle));
+            }
+        }
+        nodes.clear();  // Drop the handles of the survivors
+        for (const ValuePtr& value : garbage) {
+            value->list_value.clear();
+            value->dict_value.clear();
+            value->instance_slots.clear();
+            value->generator_values.clear();
+        }
+        garbage.clear();
+        int64_t freed = live_before - live_values();
+        return freed > 0 ? static_cast<size_t>(freed) : 0;
+    }
+
+    static int64_t live_values() {
+        int64_t total = 0;
+        for (int64_t count : ValueCounters::live) {
+            total += count;
+        }
+        return total;
+    }
+
+    // Heap dump: live counts, a summary of what the roots reach, the named
+    // roots by deep size and the object graph (ids are dump-local)
+    static void write_json(std::ostream& out, const std::vector<std::pair<std::string, ValuePtr>>& roots,
+                           size_t max_objects = 100000) {
+        out << "{\n  \"live\": {";
+        for (size_t i = 0; i < ValueCounters::TYPE_COUNT; i++) {
+            out << (i == 0 ? "" : ", ") << "\"" << value_type_name(static_cast<ValueType>(i))
+                << "\": " << ValueCounters::live[i];
+        }
+        out << "},\n";
+
+        // Each named root by its own deep size (shared values count for each)
+        std::vector<std::pair<size_t, size_t>> root_sizes;  // (bytes, root index)
+        HeapWalker reachable;
+        for (size_t i = 0; i < roots.size(); i++) {
+            root_sizes.push_back({deep_bytes(roots[i].second), i});
+            reachable.visit(roots[i].second);
+        }
+        const Summary& summary = reachable.totals();
+        out << "  \"reachable\": {\"values\": " << summary.values << ", \"bytes\": " << summary.bytes
+            << ", \"string_bytes\": " << summary.string_bytes << ", \"list_capacity\": " << summary.list_capacity
+            << ", \"dict_capacity\": " << summary.dict_capacity << "},\n";
+
+        std::stable_sort(root_sizes.begin(), root_sizes.end(),
+                         [](const auto& a, const auto& b) { return a.first > b.first; });
+        out << "  \"roots\": [";
+        for (size_t i = 0; i < root_sizes.size(); i++) {
+            const auto& root = roots[root_sizes[i].second];
+            out << (i == 0 ? "\n" : ",\n") << "    {\"name\": " << json_string(root.first) << ", \"type\": \""
+                << value_type_name(root.second->type) << "\", \"deep_bytes\": " << root_sizes[i].first << "}";
+        }
+        out << "\n  ],\n";
+
+        // Object graph, breadth first from the roots
+        std::unordered_map<const Value*, size_t> ids;
+        std::vector<const Value*> order;
+        auto id_of = [&ids, &order](const Value* value) {
+            auto it = ids.find(value);
+            if (it != ids.end()) {
+                return it->second;
+            }
+            ids.emplace(value, order.size());
+            order.push_back(value);
+            return order.size() - 1;
+        };
+        for (const auto& root : roots) {
+            id_of(root.second.get());
+        }
+        out << "  \"objects\": [";
+        size_t written = 0;
+        for (; written < order.size() && written < max_objects; written++) {
+            const Value* value = order[written];
+            out << (written == 0 ? "\n" : ",\n") << "    {\"id\": " << written << ", \"type\": \""
+                << value_type_name(value->type) << "\", \"bytes\": " << shallow_bytes(*value);
+            if (value->type == ValueType::INSTANCE) {
+                out << ", \"class\": " << json_string(value->class_name);
+            }
+            out << ", \"refs\": [";
+            bool first = true;
+            for_each_child(*value, [&](const ValuePtr& child) {
+                if (child != nullptr) {
+                    out << (first ? "" : ", ") << id_of(child.get());
+                    first = false;
+                }
+            });
+            out << "]}";
+        }
+        out << "\n  ],\n  \"truncated\": " << (written < order.size() ? "true" : "false") << "\n}\n";
+    }
+
+private:
+    std::unordered_set<const Value*> seen;
+    std::vector<const Value*> pending;
+    Summary summary;
+
+    // Heap bytes of a string (nothing while it fits the inline buffer)
+    static size_t string_bytes(const std::string& text) {
+        return text.capacity() > std::string().capacity() ? text.capacity() + 1 : 0;
+    }
+
+    static std::string json_string(const std::string& text) {
+        std::string quoted = "\"";
+        for (unsigned char c : text) {
+            if (c == '"' || c == '\\') {
+                quoted += '\\';
+                quoted += static_cast<char>(c);
+            } else if (c < 0x20) {
+                char code[8];
+                std::snprintf(code, sizeof(code), "\\u%04x", c);
+                quoted += code;
+            } else {
+                quoted += static_cast<char>(c);
+            }
+        }
+        return quoted + "\"";
+    }
+};
+
+}  // namespace susa
+
+#endif  // SUSA_HEAP_HPP
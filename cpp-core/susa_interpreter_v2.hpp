@@ -6,46 +6,194 @@
 #include "susa_modules.hpp"
 #include "susa_function.hpp"
 #include "susa_error.hpp"
+#include "susa_optimizer.hpp"
+#include "susa_jit.hpp"
+#include "susa_native.hpp"
+#include "susa_profiler.hpp"
+#include "susa_heap.hpp"
+#include "susa_memory.hpp"
 #include <map>
 #include <stack>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <set>
 #include <sstream>
+#include <unordered_map>
+#include <cstdint>
+#include <limits>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// One operation for the --stats histogram. Without SUSA_STATS this expands
+// to nothing, arguments included.
+#ifdef SUSA_STATS
+#define SUSA_STAT(category, name) \
+    do { \
+        if (op_stats != nullptr) op_stats->count(category, name); \
+    } while (0)
+#else
+#define SUSA_STAT(category, name) \
+    do { \
+    } while (0)
+#endif
 
 namespace susa {
 
 class Environment {
 public:
-    std::map<std::string, ValuePtr> variables;
+    struct Binding {
+        std::string name;
+        ValuePtr value;
+    };
+    
+    // Variables in definition order. Function scopes hold a handful of names
+    // and are scanned linearly; once a scope grows past INDEX_THRESHOLD (the
+    // global scope, typically) a hash index is built over it.
+    std::vector<Binding> variables;
+    std::unordered_map<std::string, size_t> index;
     std::map<std::string, bool> const_flags;  // Track which variables are const
+    std::map<std::string, ValueType> declared_types;  // INT/FLOAT/BOOL/STRING declarations
     std::shared_ptr<Environment> parent;
     
+    static const size_t INDEX_THRESHOLD = 16;
+    
     Environment(std::shared_ptr<Environment> p = nullptr) : parent(p) {}
     
+    // Empty the scope for reuse as a new call frame (keeps vector capacity)
+    void reset(std::shared_ptr<Environment> p) {
+        variables.clear();
+        index.clear();
+        const_flags.clear();
+        declared_types.clear();
+        parent = std::move(p);
+    }
+    
+    ValuePtr* find_local(const std::string& name) {
+        if (!index.empty()) {
+            auto it = index.find(name);
+            return it == index.end() ? nullptr : &variables[it->second].value;
+        }
+        for (auto& binding : variables) {
+            if (binding.name == name) {
+                return &binding.value;
+            }
+        }
+        return nullptr;
+    }
+    
+    // Append a new binding (name must not exist in this scope yet)
+    void define(const std::string& name, ValuePtr value) {
+        variables.push_back({name, std::move(value)});
+        if (!index.empty()) {
+            index[name] = variables.size() - 1;
+        } else if (variables.size() > INDEX_THRESHOLD) {
+            for (size_t i = 0; i < variables.size(); i++) {
+                index[variables[i].name] = i;
+            }
+        }
+    }
+    
+    static const char* declared_type_name(ValueType type) {
+        switch (type) {
+            case ValueType::INTEGER: return "INT";
+            case ValueType::NUMBER: return "FLOAT";
+            case ValueType::BOOLEAN: return "BOOL";
+            case ValueType::STRING: return "STRING";
+            default: return "?";
+        }
+    }
+    
+    // Convert a value to a variable's declared type, or throw on a mismatch
+    static ValuePtr coerce_declared(const std::string& name, ValueType declared, const ValuePtr& value) {
+        if (value->type == declared) {
+            return value;
+        }
+        if (declared == ValueType::INTEGER && value->type == ValueType::NUMBER &&
+            value->number_value == std::trunc(value->number_value)) {
+            return Value::make_int(value->to_int());
+        }
+        if (declared == ValueType::NUMBER && value->type == ValueType::INTEGER) {
+            return Value::make_number(value->to_number());
+        }
+        throw std::runtime_error("Type mismatch: cannot assign '" + value->to_string() +
+                                 "' to " + declared_type_name(declared) + " variable: " + name);
+    }
+    
+    void declare(const std::string& name, ValueType type) {
+        declared_types[name] = type;
+    }
+    
+    void undeclare(const std::string& name) {
+        declared_types.erase(name);
+    }
+    
+    // Storage of a declared INT/FLOAT variable in this scope when nothing else
+    // references its Value, so it can be updated in place without reallocating
+    Value* typed_slot(const std::string& name, ValueType& declared) {
+        if (declared_types.empty()) {
+            return nullptr;
+        }
+        auto type_it = declared_types.find(name);
+        if (type_it == declared_types.end()) {
+            return nullptr;
+        }
+        ValuePtr* stored = find_local(name);
+        if (stored == nullptr || stored->use_count() != 1 ||
+            (*stored)->type != type_it->second) {
+            return nullptr;
+        }
+        declared = type_it->second;
+        return stored->get();
+    }
+    
     void set(const std::string& name, ValuePtr value, bool is_const = false) {
         // Check if variable is const
-        if (const_flags.find(name) != const_flags.end() && const_flags[name]) {
+        if (!const_flags.empty() && const_flags.find(name) != const_flags.end() && const_flags[name]) {
             throw std::runtime_error("Cannot reassign const variable: " + name);
         }
-        variables[name] = value;
+        if (!declared_types.empty()) {
+            auto typed = declared_types.find(name);
+            if (typed != declared_types.end()) {
+                value = coerce_declared(name, typed->second, value);
+            }
+        }
+        ValuePtr* stored = find_local(name);
+        if (stored != nullptr) {
+            *stored = std::move(value);
+        } else {
+            define(name, std::move(value));
+        }
         if (is_const) {
             const_flags[name] = true;
         }
     }
     
-    ValuePtr get(const std::string& name) {
-        auto it = variables.find(name);
-        if (it != variables.end()) {
-            return it->second;
+    // Binding of a name in this scope or the nearest enclosing one
+    ValuePtr* lookup(const std::string& name) {
+        for (Environment* env = this; env != nullptr; env = env->parent.get()) {
+            ValuePtr* stored = env->find_local(name);
+            if (stored != nullptr) {
+                return stored;
+            }
         }
-        if (parent) {
-            return parent->get(name);
+        return nullptr;
+    }
+    
+    ValuePtr get(const std::string& name) {
+        ValuePtr* stored = lookup(name);
+        if (stored != nullptr) {
+            return *stored;
         }
         return nullptr;  // Return nullptr for undefined variables
     }
     
     bool has(const std::string& name) {
-        if (variables.find(name) != variables.end()) {
+        if (find_local(name) != nullptr) {
             return true;
         }
         if (parent) {
@@ -55,6 +203,47 @@ public:
     }
 };
 
+// Phase timings and counters of one execute() (shown by --benchmark)
+struct ExecutionStats {
+    double lex_ms = 0;
+    double optimize_ms = 0;     // Token optimizer: the parse-time passes
+    double execute_ms = 0;
+    double jit_compile_ms = 0;  // Native loop compilation, part of execute_ms
+    size_t tokens = 0;
+    uint64_t calls = 0;          // User functions, methods and lambdas
+    uint64_t builtin_calls = 0;  // Builtin and module functions
+    uint64_t instructions = 0;   // Budget ticks: loop iterations and calls
+    size_t memory_peak = 0;      // Most memory held at once (tracked runs only)
+    uint64_t values_created[ValueCounters::TYPE_COUNT] = {};
+};
+
+// Limits on one run, 0 leaving a limit off. Running out raises a BudgetError
+// (MemoryError for memory), which TRY/CATCH can handle. The memory limit is
+// enforced on each allocation when the program uses the accounting allocator,
+// and otherwise checked against the process's peak resident set.
+struct ExecutionBudget {
+    uint64_t instructions = 0;  // Loop iterations plus calls
+    double wall_ms = 0;         // Since the execute phase began
+    size_t memory_bytes = 0;    // Memory held by the interpreter (see MemoryAccount)
+};
+
+// Peak resident set of the process in bytes (0 where it can't be read)
+inline size_t peak_resident_bytes() {
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
 class Interpreter {
 private:
     std::vector<Token> tokens;
@@ -93,16 +282,364 @@ private:
         bool is_async;  // True if function is ASYNC
         size_t body_start;
         size_t body_end;
+        size_t min_args;  // Parameters without a default value
+        NativeFunction native = nullptr;  // Body lowered to C++ by `susa build`
     };
     std::map<std::string, Function> functions;
     
+    // Lowered bodies registered before the run, by FUNC name and body position
+    std::map<std::pair<std::string, size_t>, NativeFunction> native_functions;
+    
+    // Native stack one lowered call may take; bounds nested lowered calls
+    static const size_t NATIVE_FRAME_BYTES = 512;
+    
     // Class storage
     struct Class {
         std::string name;
         std::map<std::string, Function> methods;  // method_name -> Function
         std::string parent_class;  // For inheritance (empty if none)
+        ShapePtr root_shape;  // Empty shape every new instance starts from
+        uint32_t id;  // Unique per class definition, matches Shape::class_id
     };
     std::map<std::string, Class> classes;
+    uint32_t next_class_id = 1;
+    
+    // Polymorphic inline cache for one method call site, keyed on class identity
+    struct MethodCache {
+        static const int ENTRIES = 4;
+        uint32_t class_ids[ENTRIES];
+        Function* methods[ENTRIES];
+        int count = 0;
+    };
+    std::vector<MethodCache> method_caches;
+    
+    // Monomorphic inline cache for one property read site
+    struct PropertyCache {
+        ShapePtr shape;
+        uint32_t slot = 0;
+    };
+    std::vector<PropertyCache> property_caches;
+    
+    // Dispatch table for a SWITCH whose CASE labels are all literals. Labels
+    // map to the first case they select; string labels are indexed both by
+    // content and by numeric value to keep the sequential matching rules.
+    struct SwitchTable {
+        static const size_t NO_CASE = SIZE_MAX;
+        bool built = false;
+        bool usable = false;
+        std::unordered_map<double, size_t> numeric_labels;
+        std::unordered_map<std::string, size_t> string_labels;
+        std::unordered_map<double, size_t> string_label_numbers;
+        std::vector<std::pair<size_t, size_t>> blocks;  // Case body token ranges
+        size_t default_case = NO_CASE;
+        size_t end_pos = 0;  // The switch's END token
+    };
+    std::vector<SwitchTable> switch_tables;
+
+    // Superinstructions: common loop idioms recognised from their token shape
+    // the first time a site runs, then executed as one fused operation. Any
+    // guard failure (wrong types, non-local or const/typed variable, index out
+    // of range) falls back to the generic path, which also reports errors.
+    enum class FusedKind : uint8_t {
+        NONE,
+        INCREMENT,           // x += 1, x -= 2, x++, x--
+        ACCUMULATE_INDEXED,  // t = t + x[i], t += x[i]
+        COMPARE,             // WHILE / LOOP WHILE / IF  i < n:
+        LOAD_INDEXED         // x[i], x[3] inside an expression
+    };
+    struct FusedOp {
+        bool decoded = false;
+        FusedKind kind = FusedKind::NONE;
+        TokenType op = TokenType::PLUS;  // Step direction or comparison
+        ValuePtr constant;               // Literal operand (step, bound or index)
+        size_t length = 0;               // Tokens covered by the fused form
+    };
+    std::vector<FusedOp> fused_ops;
+    
+    // Operand types observed at each arithmetic, comparison and indexing
+    // site (keyed on the operator or '[' token). A site that has only seen
+    // one kind runs a specialized path behind a cheap type guard; once it
+    // sees a second kind it stays on the generic path.
+    enum class TypeFeedback : uint8_t {
+        UNSEEN,
+        INTEGERS,    // INTEGER op INTEGER
+        NUMBERS,     // NUMBER op NUMBER
+        LIST_INDEX,  // LIST[INTEGER]
+        GENERIC
+    };
+    std::vector<TypeFeedback> type_feedback;
+    
+    // WHILE / LOOP WHILE loops are compiled to native code (susa_jit.hpp) once
+    // they have run JIT_HOT_ITERATIONS iterations, counted per loop across
+    // entries. A loop that keeps failing guards is dropped back to the
+    // interpreter for good.
+    static const size_t JIT_HOT_ITERATIONS = 64;
+    static const size_t JIT_MAX_DEOPTS = 16;
+    struct JitLoopSite {
+        size_t iterations = 0;
+        size_t deopts = 0;
+        bool compiled = false;  // Compilation attempted
+        std::unique_ptr<CompiledLoop> loop;
+    };
+    std::vector<JitLoopSite> jit_sites;
+    bool jit = true;
+    std::vector<int64_t> jit_frame;
+    std::vector<ValuePtr*> jit_bindings;
+    
+    enum class JitRun {
+        NOT_RUN,    // Interpret this iteration
+        ITERATION,  // One iteration finished (after a guard failure)
+        FINISHED    // The loop is done
+    };
+
+    // Call frames are recycled through a pool instead of being allocated per
+    // call; a frame still referenced elsewhere (a closure) is left to its owners
+    static const size_t FRAME_POOL_MAX = 256;
+    std::vector<std::shared_ptr<Environment>> frame_pool;
+    
+    // Call arguments are evaluated onto this stack and bound by index
+    std::vector<ValuePtr> arg_stack;
+    
+    // Shared NULL used as the default return value of every call
+    ValuePtr null_value;
+    
+    // Interpreter call stack. SUSA calls still nest native calls, so depth is
+    // bounded by a guard on native stack usage, and by max_call_depth when
+    // the embedder or --max-depth sets one.
+    struct CallFrame {
+        const std::string* name;
+        Function* func;
+        size_t try_depth;  // TRY blocks open when the frame was entered
+        bool allows_tail_call;  // Plain function frames only
+        Environment* env = nullptr;  // Set once the frame is bound (heap roots)
+    };
+    std::vector<CallFrame> call_stack;
+    size_t max_call_depth = std::numeric_limits<size_t>::max();
+    size_t try_depth = 0;
+    uintptr_t native_stack_base = 0;
+    size_t native_stack_limit = 0;
+    
+    // Pending tail call requested by RETURN f(...), run by call_function in
+    // place of the current frame
+    Function* tail_call = nullptr;
+    const std::string* tail_call_name = nullptr;
+    std::vector<ValuePtr> tail_args;
+    
+    // Run the token optimizer over each program before executing it
+    bool optimize = true;
+    
+    // Counters of the current / last run, and where its execute phase began
+    ExecutionStats run_stats;
+    std::chrono::steady_clock::time_point execute_started;
+    bool execute_phase_started = false;
+
+    // Execution budget. Every loop iteration and call takes one tick from
+    // budget_ticks, and only when a slice runs out does check_budget() look
+    // at the limits, so the hot paths pay a decrement. Compiled loops count
+    // down the same slice in their iteration-allowance slot.
+    static constexpr int64_t BUDGET_CHECK_INTERVAL = 4096;
+    ExecutionBudget budget;
+    
+    // What this interpreter has allocated (filled in by the accounting
+    // allocator, when the program installs it, and only for runs with a
+    // memory limit or tracking turned on)
+    MemoryAccount memory;
+    bool track_memory = false;
+    int64_t budget_slice = 0;   // Ticks handed out by the last check
+    int64_t budget_ticks = 0;   // Ticks left of that slice
+    uint64_t budget_spent = 0;  // Ticks of the slices before it
+
+    // Optional call/line profiler, stack sampler and tracer (owned by the caller)
+    Profiler* profiler = nullptr;
+    SamplingProfiler* sampler = nullptr;
+    Tracer* tracer = nullptr;
+    OpStats* op_stats = nullptr;  // Only fed in SUSA_STATS builds
+    
+    // Largest returned expression (in tokens) of a function inlined at its
+    // call sites; 0 turns inlining off
+    static const size_t DEFAULT_INLINE_LIMIT = 24;
+    size_t inline_limit = DEFAULT_INLINE_LIMIT;
+    
+    // Stack the susa CLI and built programs ask for (see raise_stack_limit)
+    static const size_t DEEP_STACK_BYTES = 64 * 1024 * 1024;
+    
+    static size_t default_native_stack_limit() {
+#ifdef _WIN32
+        return 768 * 1024;
+#else
+        struct rlimit limit;
+        if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+            return static_cast<size_t>(limit.rlim_cur) / 4 * 3;
+        }
+        return 48 * 1024 * 1024;
+#endif
+    }
+    
+    // `runtime` module: heap introspection over this interpreter's values
+    void register_runtime_module() {
+        builtin_modules.register_function("runtime", "heap_stats", [this](const std::vector<ValuePtr>& args) {
+            if (!args.empty()) throw_argument_error("heap_stats", 0, args.size());
+            HeapWalker walker;
+            for (const auto& root : heap_roots(true)) {
+                walker.visit(root.second);
+            }
+            const HeapWalker::Summary& summary = walker.totals();
+            ValuePtr live = Value::make_dict();
+            int64_t live_total = 0;
+            for (size_t i = 0; i < ValueCounters::TYPE_COUNT; i++) {
+                live->dict_value.set(Value::make_string(value_type_name(static_cast<ValueType>(i))),
+                                     Value::make_int(ValueCounters::live[i]));
+                live_total += ValueCounters::live[i];
+            }
+            ValuePtr stats = Value::make_dict();
+            auto field = [&stats](const char* name, int64_t number) {
+                stats->dict_value.set(Value::make_string(name), Value::make_int(number));
+            };
+            stats->dict_value.set(Value::make_string("live"), live);
+            field("live_total", live_total);
+            field("reachable_values", static_cast<int64_t>(summary.values));
+            field("reachable_bytes", static_cast<int64_t>(summary.bytes));
+            field("string_bytes", static_cast<int64_t>(summary.string_bytes));
+            field("list_capacity", static_cast<int64_t>(summary.list_capacity));
+            field("dict_capacity", static_cast<int64_t>(summary.dict_capacity));
+            if (run_account() != nullptr) {
+                field("allocated_bytes", static_cast<int64_t>(memory.used()));
+            }
+            return stats;
+        });
+        builtin_modules.register_function("runtime", "object_size", [this](const std::vector<ValuePtr>& args) {
+            if (args.size() != 1) throw_argument_error("object_size", 1, args.size());
+            return Value::make_int(static_cast<int64_t>(HeapWalker::deep_bytes(args[0])));
+        });
+        builtin_modules.register_function("runtime", "gc", [this](const std::vector<ValuePtr>& args) {
+            if (!args.empty()) throw_argument_error("gc", 0, args.size());
+            frame_pool.clear();
+            return Value::make_int(static_cast<int64_t>(HeapWalker::collect_cycles()));
+        });
+    }
+    
+    // Named values the program can still reach: globals, statics, enum
+    // members and, while running, every call frame and the argument stack
+    std::vector<std::pair<std::string, ValuePtr>> heap_roots(bool running) {
+        std::vector<std::pair<std::string, ValuePtr>> roots;
+        for (const auto& binding : global_env->variables) {
+            roots.push_back({binding.name, binding.value});
+        }
+        for (const auto& var : static_variables) {
+            roots.push_back({"static " + var.first, var.second});
+        }
+        for (const auto& enum_type : enums) {
+            for (const auto& member : enum_type.second) {
+                roots.push_back({enum_type.first + "." + member.first, member.second});
+            }
+        }
+        if (!running) {
+            return roots;
+        }
+        std::set<const Environment*> scopes = {global_env.get()};
+        auto add_scope = [&roots, &scopes](const Environment* scope, const std::string& owner) {
+            if (scope == nullptr || !scopes.insert(scope).second) {
+                return;
+            }
+            for (const auto& binding : scope->variables) {
+                roots.push_back({owner + ":" + binding.name, binding.value});
+            }
+        };
+        for (const CallFrame& frame : call_stack) {
+            add_scope(frame.env, *frame.name);
+        }
+        for (const Environment* scope = current_env.get(); scope != nullptr; scope = scope->parent.get()) {
+            add_scope(scope, "<local>");
+        }
+        for (const ValuePtr& arg : arg_stack) {
+            roots.push_back({"<argument>", arg});
+        }
+        return roots;
+    }
+    
+    void write_heap_dump(const std::string& path) {
+        std::ofstream out(path);
+        if (out.is_open()) {
+            HeapWalker::write_json(out, heap_roots(false));
+        }
+    }
+    
+    // Record the SUSA call stack for the sampler's pending ticks
+    void take_sample() {
+        int ticks = SamplingProfiler::take_ticks();
+        if (sampler == nullptr || ticks <= 0) {
+            return;
+        }
+        std::string stack = "<main>";
+        for (const CallFrame& frame : call_stack) {
+            stack += ';';
+            stack += *frame.name;
+        }
+        sampler->record(stack, ticks);
+    }
+    
+    size_t native_stack_used() const {
+        char marker;
+        uintptr_t here = reinterpret_cast<uintptr_t>(&marker);
+        return here < native_stack_base ? native_stack_base - here : here - native_stack_base;
+    }
+    
+    void enter_frame(const std::string& name, Function& func, bool allows_tail_call) {
+        if (call_stack.size() >= max_call_depth) {
+            throw_recursion_error(name);
+        }
+        if (native_stack_used() > native_stack_limit) {
+            throw_recursion_error(name);
+        }
+        budget_tick();
+        call_stack.push_back({&name, &func, try_depth, allows_tail_call});
+        run_stats.calls++;
+    }
+    
+    std::shared_ptr<Environment> acquire_frame(const std::shared_ptr<Environment>& parent) {
+        if (frame_pool.empty()) {
+            return std::make_shared<Environment>(parent);
+        }
+        std::shared_ptr<Environment> frame = std::move(frame_pool.back());
+        frame_pool.pop_back();
+        frame->parent = parent;
+        return frame;
+    }
+    
+    void release_frame(std::shared_ptr<Environment>& frame) {
+        if (frame.use_count() == 1 && frame_pool.size() < FRAME_POOL_MAX) {
+            frame->reset(nullptr);
+            frame_pool.push_back(std::move(frame));
+        }
+        frame.reset();
+    }
+    
+    // Site caches hang off tokens of the program; lambda bodies are re-lexed
+    // on every call, so caching is switched off while one runs
+    bool site_caching = true;
+    
+    static size_t count_required_params(const Function& func) {
+        size_t required = 0;
+        for (const auto& param : func.params) {
+            if (func.default_values.find(param) == func.default_values.end()) {
+                required++;
+            }
+        }
+        return required;
+    }
+    
+    // Cache slot for a site token, allocated on first use (-1 when caching is off)
+    template <typename CacheT>
+    int site_cache_slot(Token& site, std::vector<CacheT>& caches) {
+        if (!site_caching) {
+            return -1;
+        }
+        if (site.cache_slot < 0) {
+            site.cache_slot = static_cast<int>(caches.size());
+            caches.emplace_back();
+        }
+        return site.cache_slot;
+    }
     
     Token& peek(int offset = 0) {
         size_t pos = current + offset;
@@ -125,6 +662,22 @@ private:
         throw std::runtime_error(error_handler.format_error(error));
     }
     
+    // Text of a caught error; failed allocations are reported as a MemoryError
+    // at the current statement
+    std::string error_message(const std::exception& e) {
+        if (dynamic_cast<const std::bad_alloc*>(&e) == nullptr) {
+            return e.what();
+        }
+        const char* message = dynamic_cast<const MemoryLimitExceeded*>(&e) != nullptr ? e.what() : "Out of memory";
+        int line = -1;
+        int column = -1;
+        if (current < tokens.size()) {  // No tokens yet when lexing ran out
+            line = tokens[current].line;
+            column = tokens[current].column;
+        }
+        return error_handler.format_error(error_handler.create_error(ErrorType::MEMORY_ERROR, message, line, column));
+    }
+    
     void throw_syntax_error(const std::string& message) {
         throw_error(ErrorType::SYNTAX_ERROR, message);
     }
@@ -161,12 +714,121 @@ private:
         throw_error(ErrorType::KEY_ERROR, "Key '" + key + "' not found");
     }
     
+    void check_dict_key(const ValuePtr& key) {
+        if (!Dict::is_hashable(key)) {
+            throw_type_error("Dictionary keys must be strings, numbers or booleans");
+        }
+    }
+    
+    void throw_recursion_error(const std::string& func) {
+        std::ostringstream oss;
+        oss << "Maximum recursion depth exceeded (" << call_stack.size() << " nested calls) calling '" << func << "'";
+        throw_error(ErrorType::RECURSION_ERROR, oss.str());
+    }
+    
+    // One budget tick, taken at every backward branch and call
+    void budget_tick() {
+        if (--budget_ticks <= 0) {
+            check_budget();
+        }
+    }
+    
+    // A budget slice ran out: count it, enforce the limits and hand out the
+    // next one. A raised BudgetError leaves the slice empty, so a script that
+    // catches it runs out again at its next tick.
+    void check_budget() {
+        budget_spent += static_cast<uint64_t>(budget_slice - budget_ticks);
+        budget_slice = budget_ticks = 0;
+        if (budget.instructions > 0 && budget_spent > budget.instructions) {
+            throw_error(ErrorType::BUDGET_ERROR, "Instruction budget of " +
+                        std::to_string(budget.instructions) + " exhausted");
+        }
+        if (budget.wall_ms > 0 && elapsed_ms(execute_started) > budget.wall_ms) {
+            std::ostringstream oss;
+            oss << "Time budget of " << budget.wall_ms << " ms exceeded";
+            throw_error(ErrorType::BUDGET_ERROR, oss.str());
+        }
+        bool check_resident = budget.memory_bytes > 0 && !MemoryAccount::enabled();
+        if (check_resident && peak_resident_bytes() > budget.memory_bytes) {
+            throw_error(ErrorType::MEMORY_ERROR, "Memory limit of " + std::to_string(budget.memory_bytes) +
+                        " bytes exceeded (peak resident set)");
+        }
+        int64_t slice = std::numeric_limits<int64_t>::max();
+        if (budget.wall_ms > 0 || check_resident) {
+            slice = BUDGET_CHECK_INTERVAL;
+        }
+        if (budget.instructions > 0) {
+            slice = std::min(slice, static_cast<int64_t>(budget.instructions - budget_spent) + 1);
+        }
+        budget_slice = budget_ticks = slice;
+    }
+    
+    // Folds a binary operator on two literals for the optimizer; nullptr leaves
+    // it to runtime (division by zero, shift out of range, other operators)
+    ValuePtr fold_literal_operation(TokenType op, const ValuePtr& left, const ValuePtr& right) {
+        switch (op) {
+            case TokenType::DIVIDE:
+            case TokenType::MODULO:
+                if (right->to_number() == 0) {
+                    return nullptr;
+                }
+                return apply_arithmetic(op, left, right);
+            case TokenType::PLUS:
+            case TokenType::MINUS:
+            case TokenType::MULTIPLY:
+            case TokenType::POWER:
+                return apply_arithmetic(op, left, right);
+            case TokenType::EQUAL:
+            case TokenType::NOT_EQUAL:
+            case TokenType::LESS:
+            case TokenType::GREATER:
+            case TokenType::LESS_EQUAL:
+            case TokenType::GREATER_EQUAL:
+                return Value::make_bool(compare_values(op, left, right));
+            case TokenType::BIT_AND:
+                return Value::make_int(left->to_int() & right->to_int());
+            case TokenType::BIT_OR:
+                return Value::make_int(left->to_int() | right->to_int());
+            case TokenType::BIT_XOR:
+                return Value::make_int(left->to_int() ^ right->to_int());
+            case TokenType::LEFT_SHIFT:
+            case TokenType::RIGHT_SHIFT: {
+                int64_t shift = right->to_int();
+                if (shift < 0 || shift > 63) {
+                    return nullptr;
+                }
+                if (op == TokenType::LEFT_SHIFT) {
+                    return Value::make_int(static_cast<int64_t>(static_cast<uint64_t>(left->to_int()) << shift));
+                }
+                return Value::make_int(left->to_int() >> shift);
+            }
+            default:
+                return nullptr;
+        }
+    }
+    
     void throw_argument_error(const std::string& func, int expected, int got) {
         std::ostringstream oss;
         oss << "Function '" << func << "' expects " << expected << " argument(s), got " << got;
         throw_error(ErrorType::ARGUMENT_ERROR, oss.str());
     }
     
+    double parse_number_literal(const std::string& text) {
+        double value = 0.0;
+        if (!parse_number(text, value)) {
+            throw_syntax_error("Invalid number literal: " + text);
+        }
+        return value;
+    }
+    
+    ValuePtr number_literal_value(const std::string& text) {
+        int64_t int_literal;
+        if (parse_integer(text, int_literal)) {
+            return Value::make_int(int_literal);
+        }
+        return Value::make_number(parse_number_literal(text));
+    }
+    
     void skip_newlines() {
         while (peek().type == TokenType::NEWLINE) {
             advance();
@@ -206,7 +868,7 @@ private:
                     if (var_value == nullptr) {
                         throw_name_error(var_name);
                     }
-                    result += var_value->to_string();
+                    var_value->append_to(result);
                     
                     i = end;
                 } else {
@@ -222,6 +884,203 @@ private:
         return Value::make_string(result);
     }
     
+    // Numeric binary operators. Two INTEGER operands stay exact in int64 and
+    // promote to double only on overflow or a non-integral result.
+    ValuePtr apply_arithmetic(TokenType op, const ValuePtr& left, const ValuePtr& right) {
+        if (left->type == ValueType::INTEGER && right->type == ValueType::INTEGER) {
+            int64_t a = left->int_value;
+            int64_t b = right->int_value;
+            int64_t result;
+            
+            switch (op) {
+                case TokenType::PLUS:
+                    if (checked_add(a, b, result)) return Value::make_int(result);
+                    break;
+                case TokenType::MINUS:
+                    if (checked_sub(a, b, result)) return Value::make_int(result);
+                    break;
+                case TokenType::MULTIPLY:
+                    if (checked_mul(a, b, result)) return Value::make_int(result);
+                    break;
+                case TokenType::DIVIDE:
+                    if (b == 0) throw_zero_division_error();
+                    if (b != -1 && a % b == 0) return Value::make_int(a / b);
+                    break;
+                case TokenType::MODULO:
+                    if (b == 0) throw_zero_division_error();
+                    if (b == -1) return Value::make_int(0);
+                    return Value::make_int(a % b);
+                case TokenType::POWER:
+                    if (b >= 0) {
+                        int64_t base = a;
+                        int64_t acc = 1;
+                        bool ok = true;
+                        for (int64_t e = b; e > 0 && ok; e >>= 1) {
+                            if (e & 1) ok = checked_mul(acc, base, acc);
+                            if (ok && e > 1) ok = checked_mul(base, base, base);
+                        }
+                        if (ok) return Value::make_int(acc);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        
+        double left_num = left->to_number();
+        double right_num = right->to_number();
+        
+        switch (op) {
+            case TokenType::PLUS:
+                return Value::make_number(left_num + right_num);
+            case TokenType::MINUS:
+                return Value::make_number(left_num - right_num);
+            case TokenType::MULTIPLY:
+                return Value::make_number(left_num * right_num);
+            case TokenType::DIVIDE:
+                if (right_num == 0) throw_zero_division_error();
+                return Value::make_number(left_num / right_num);
+            case TokenType::MODULO:
+                if (right_num == 0) throw_zero_division_error();
+                return Value::make_number(std::fmod(left_num, right_num));
+            case TokenType::POWER:
+                return Value::make_number(std::pow(left_num, right_num));
+            default:
+                return left;
+        }
+    }
+    
+    TypeFeedback* feedback_site(Token& site) {
+        int slot = site_cache_slot(site, type_feedback);
+        return slot < 0 ? nullptr : &type_feedback[slot];
+    }
+    
+    static TypeFeedback classify_operands(const Value& left, const Value& right) {
+        if (left.type == right.type) {
+            if (left.type == ValueType::INTEGER) return TypeFeedback::INTEGERS;
+            if (left.type == ValueType::NUMBER) return TypeFeedback::NUMBERS;
+        }
+        return TypeFeedback::GENERIC;
+    }
+    
+    static void record_feedback(TypeFeedback& feedback, TypeFeedback observed) {
+        if (feedback == TypeFeedback::UNSEEN) {
+            feedback = observed;
+        } else if (feedback != observed) {
+            feedback = TypeFeedback::GENERIC;
+        }
+    }
+    
+    // left op= right (+ - * / %) at a site specialized on its operand types.
+    // A temporary left operand (referenced only here) is overwritten instead
+    // of allocating a result. False when the guard fails or the result needs
+    // the generic rules (overflow, division or modulo by zero, inexact
+    // integer division).
+    static bool specialized_arithmetic(TypeFeedback feedback, TokenType op,
+                                       ValuePtr& left, const Value& right) {
+        if (feedback == TypeFeedback::INTEGERS &&
+            left->type == ValueType::INTEGER && right.type == ValueType::INTEGER) {
+            int64_t a = left->int_value;
+            int64_t b = right.int_value;
+            int64_t result;
+            bool ok = false;
+            switch (op) {
+                case TokenType::PLUS: ok = checked_add(a, b, result); break;
+                case TokenType::MINUS: ok = checked_sub(a, b, result); break;
+                case TokenType::MULTIPLY: ok = checked_mul(a, b, result); break;
+                case TokenType::MODULO:
+                    ok = b > 0;
+                    if (ok) result = a % b;
+                    break;
+                default: break;
+            }
+            if (ok) {
+                store_int(left, result);
+            }
+            return ok;
+        }
+        if (feedback == TypeFeedback::NUMBERS &&
+            left->type == ValueType::NUMBER && right.type == ValueType::NUMBER) {
+            double a = left->number_value;
+            double b = right.number_value;
+            switch (op) {
+                case TokenType::PLUS: store_number(left, a + b); return true;
+                case TokenType::MINUS: store_number(left, a - b); return true;
+                case TokenType::MULTIPLY: store_number(left, a * b); return true;
+                case TokenType::DIVIDE:
+                    if (b == 0) return false;
+                    store_number(left, a / b);
+                    return true;
+                default: return false;
+            }
+        }
+        return false;
+    }
+    
+    // left = left op right at site `op_token`, specialized by type feedback
+    void arithmetic_at(Token& op_token, TokenType op, ValuePtr& left, const ValuePtr& right) {
+        TypeFeedback* feedback = feedback_site(op_token);
+        if (feedback != nullptr && *feedback != TypeFeedback::GENERIC) {
+            if (specialized_arithmetic(*feedback, op, left, *right)) {
+                return;
+            }
+            record_feedback(*feedback, classify_operands(*left, *right));
+        }
+        left = apply_arithmetic(op, left, right);
+    }
+    
+    // Ordering/equality on numbers; INTEGER pairs compare exactly
+    bool compare_values(TokenType op, const ValuePtr& left, const ValuePtr& right) {
+        if (left->type == ValueType::INTEGER && right->type == ValueType::INTEGER) {
+            int64_t a = left->int_value;
+            int64_t b = right->int_value;
+            switch (op) {
+                case TokenType::EQUAL: return a == b;
+                case TokenType::NOT_EQUAL: return a != b;
+                case TokenType::LESS: return a < b;
+                case TokenType::GREATER: return a > b;
+                case TokenType::LESS_EQUAL: return a <= b;
+                case TokenType::GREATER_EQUAL: return a >= b;
+                default: return false;
+            }
+        }
+        
+        double left_num = left->to_number();
+        double right_num = right->to_number();
+        switch (op) {
+            case TokenType::EQUAL: return left_num == right_num;
+            case TokenType::NOT_EQUAL: return left_num != right_num;
+            case TokenType::LESS: return left_num < right_num;
+            case TokenType::GREATER: return left_num > right_num;
+            case TokenType::LESS_EQUAL: return left_num <= right_num;
+            case TokenType::GREATER_EQUAL: return left_num >= right_num;
+            default: return false;
+        }
+    }
+    
+    // Comparison at site `op_token`: a site that has only compared doubles
+    // skips the integer check
+    bool compare_at(Token& op_token, TokenType op, const ValuePtr& left, const ValuePtr& right) {
+        TypeFeedback* feedback = feedback_site(op_token);
+        if (feedback != nullptr && *feedback != TypeFeedback::GENERIC) {
+            if (*feedback == TypeFeedback::NUMBERS &&
+                left->type == ValueType::NUMBER && right->type == ValueType::NUMBER) {
+                double a = left->number_value;
+                double b = right->number_value;
+                switch (op) {
+                    case TokenType::EQUAL: return a == b;
+                    case TokenType::NOT_EQUAL: return a != b;
+                    case TokenType::LESS: return a < b;
+                    case TokenType::GREATER: return a > b;
+                    case TokenType::LESS_EQUAL: return a <= b;
+                    default: return a >= b;
+                }
+            }
+            record_feedback(*feedback, classify_operands(*left, *right));
+        }
+        return compare_values(op, left, right);
+    }
+    
     ValuePtr evaluate_or() {
         ValuePtr left = evaluate_and();
         
@@ -259,28 +1118,15 @@ private:
         ValuePtr left = evaluate_bitwise_or();
         
         while (true) {
-            TokenType op = peek().type;
+            Token& op_token = peek();
+            TokenType op = op_token.type;
             if (op == TokenType::EQUAL || op == TokenType::NOT_EQUAL ||
                 op == TokenType::LESS || op == TokenType::GREATER ||
                 op == TokenType::LESS_EQUAL || op == TokenType::GREATER_EQUAL) {
                 advance();
                 ValuePtr right = evaluate_bitwise_or();
-                
-                double left_num = left->to_number();
-                double right_num = right->to_number();
-                
-                bool result = false;
-                switch (op) {
-                    case TokenType::EQUAL: result = (left_num == right_num); break;
-                    case TokenType::NOT_EQUAL: result = (left_num != right_num); break;
-                    case TokenType::LESS: result = (left_num < right_num); break;
-                    case TokenType::GREATER: result = (left_num > right_num); break;
-                    case TokenType::LESS_EQUAL: result = (left_num <= right_num); break;
-                    case TokenType::GREATER_EQUAL: result = (left_num >= right_num); break;
-                    default: break;
-                }
-                
-                left = Value::make_bool(result);
+                SUSA_STAT("compare", op_token.value);
+                left = Value::make_bool(compare_at(op_token, op, left, right));
             } else {
                 break;
             }
@@ -295,9 +1141,7 @@ private:
         while (peek().type == TokenType::BIT_OR) {
             advance();
             ValuePtr right = evaluate_bitwise_xor();
-            int left_int = static_cast<int>(left->to_number());
-            int right_int = static_cast<int>(right->to_number());
-            left = Value::make_number(left_int | right_int);
+            left = Value::make_int(left->to_int() | right->to_int());
         }
         
         return left;
@@ -309,9 +1153,7 @@ private:
         while (peek().type == TokenType::BIT_XOR) {
             advance();
             ValuePtr right = evaluate_bitwise_and();
-            int left_int = static_cast<int>(left->to_number());
-            int right_int = static_cast<int>(right->to_number());
-            left = Value::make_number(left_int ^ right_int);
+            left = Value::make_int(left->to_int() ^ right->to_int());
         }
         
         return left;
@@ -323,9 +1165,7 @@ private:
         while (peek().type == TokenType::BIT_AND) {
             advance();
             ValuePtr right = evaluate_shift();
-            int left_int = static_cast<int>(left->to_number());
-            int right_int = static_cast<int>(right->to_number());
-            left = Value::make_number(left_int & right_int);
+            left = Value::make_int(left->to_int() & right->to_int());
         }
         
         return left;
@@ -338,13 +1178,16 @@ private:
             TokenType op = peek().type;
             advance();
             ValuePtr right = evaluate_addition();
-            int left_int = static_cast<int>(left->to_number());
-            int right_int = static_cast<int>(right->to_number());
+            int64_t left_int = left->to_int();
+            int64_t shift = right->to_int();
             
+            if (shift < 0 || shift > 63) {
+                throw_value_error("Shift count out of range: " + right->to_string());
+            }
             if (op == TokenType::LEFT_SHIFT) {
-                left = Value::make_number(left_int << right_int);
+                left = Value::make_int(static_cast<int64_t>(static_cast<uint64_t>(left_int) << shift));
             } else {
-                left = Value::make_number(left_int >> right_int);
+                left = Value::make_int(left_int >> shift);
             }
         }
         
@@ -355,24 +1198,35 @@ private:
         ValuePtr left = evaluate_multiplication();
         
         while (peek().type == TokenType::PLUS || peek().type == TokenType::MINUS) {
-            TokenType op = peek().type;
+            Token& op_token = peek();
+            TokenType op = op_token.type;
             advance();
             ValuePtr right = evaluate_multiplication();
             
+            // Sites that have only seen numbers skip the string checks
+            TypeFeedback* feedback = feedback_site(op_token);
+            if (feedback != nullptr && *feedback != TypeFeedback::GENERIC) {
+                if (specialized_arithmetic(*feedback, op, left, *right)) {
+                    continue;
+                }
+                record_feedback(*feedback, classify_operands(*left, *right));
+            }
+            
             if (op == TokenType::PLUS) {
                 if (left->type == ValueType::STRING || right->type == ValueType::STRING) {
-                    left = Value::make_string(left->to_string() + right->to_string());
-                } else if (left->type == ValueType::NUMBER && right->type == ValueType::NUMBER) {
-                    left = Value::make_number(left->to_number() + right->to_number());
+                    std::string result;
+                    left->append_to(result);
+                    right->append_to(result);
+                    left = Value::make_string(result);
                 } else {
                     // Allow implicit conversion to number for addition
-                    left = Value::make_number(left->to_number() + right->to_number());
+                    left = apply_arithmetic(op, left, right);
                 }
             } else {
                 if (left->type == ValueType::STRING || right->type == ValueType::STRING) {
                     throw_type_error("Cannot subtract strings");
                 }
-                left = Value::make_number(left->to_number() - right->to_number());
+                left = apply_arithmetic(op, left, right);
             }
         }
         
@@ -385,26 +1239,11 @@ private:
         while (peek().type == TokenType::MULTIPLY || 
                peek().type == TokenType::DIVIDE || 
                peek().type == TokenType::MODULO) {
-            TokenType op = peek().type;
+            Token& op_token = peek();
+            TokenType op = op_token.type;
             advance();
             ValuePtr right = evaluate_power();
-            
-            double left_num = left->to_number();
-            double right_num = right->to_number();
-            
-            if (op == TokenType::MULTIPLY) {
-                left = Value::make_number(left_num * right_num);
-            } else if (op == TokenType::DIVIDE) {
-                if (right_num == 0) {
-                    throw_zero_division_error();
-                }
-                left = Value::make_number(left_num / right_num);
-            } else {
-                if (right_num == 0) {
-                    throw_zero_division_error();
-                }
-                left = Value::make_number(std::fmod(left_num, right_num));
-            }
+            arithmetic_at(op_token, op, left, right);
         }
         
         return left;
@@ -416,7 +1255,7 @@ private:
         if (peek().type == TokenType::POWER) {
             advance();
             ValuePtr right = evaluate_power();
-            left = Value::make_number(std::pow(left->to_number(), right->to_number()));
+            left = apply_arithmetic(TokenType::POWER, left, right);
         }
         
         return left;
@@ -426,13 +1265,16 @@ private:
         if (peek().type == TokenType::MINUS) {
             advance();
             ValuePtr value = evaluate_unary();
+            if (value->type == ValueType::INTEGER &&
+                value->int_value != std::numeric_limits<int64_t>::min()) {
+                return Value::make_int(-value->int_value);
+            }
             return Value::make_number(-value->to_number());
         }
         if (peek().type == TokenType::BIT_NOT) {
             advance();
             ValuePtr value = evaluate_unary();
-            int int_val = static_cast<int>(value->to_number());
-            return Value::make_number(~int_val);
+            return Value::make_int(~value->to_int());
         }
         return evaluate_primary();
     }
@@ -450,7 +1292,7 @@ private:
         
         if (token.type == TokenType::NUMBER) {
             advance();
-            return Value::make_number(std::stod(token.value));
+            return number_literal_value(token.value);
         }
         
         if (token.type == TokenType::STRING) {
@@ -530,6 +1372,13 @@ private:
         }
         
         if (token.type == TokenType::IDENTIFIER) {
+            if (peek(1).type == TokenType::LBRACKET) {
+                ValuePtr element = evaluate_fused_index(token);
+                if (element != nullptr) {
+                    return element;
+                }
+            }
+            
             std::string name = token.value;
             advance();
             
@@ -540,6 +1389,7 @@ private:
                     throw std::runtime_error("Expected identifier after '.'");
                 }
                 std::string member = peek().value;
+                size_t member_pos = current;
                 advance();
                 
                 // Check if it's an enum
@@ -556,6 +1406,10 @@ private:
                     ValuePtr var = current_env->get(name);
                     
                     if (var == nullptr) {
+                        // module.function() on a module brought in by ADD
+                        if (imported_modules.find(name) != imported_modules.end()) {
+                            return evaluate_module_function_call(name, member);
+                        }
                         throw_name_error(name);
                     }
                     
@@ -563,11 +1417,12 @@ private:
                     if (var->type == ValueType::INSTANCE) {
                         advance(); // Skip '('
                         
-                        std::vector<ValuePtr> args;
-                        args.push_back(var); // Add self as first argument
+                        size_t arg_base = arg_stack.size();
+                        arg_stack.push_back(var); // Add self as first argument
                         
                         while (peek().type != TokenType::RPAREN && peek().type != TokenType::EOF_TOKEN) {
-                            args.push_back(evaluate_expression());
+                            ValuePtr arg = evaluate_expression();
+                            arg_stack.push_back(std::move(arg));
                             if (peek().type == TokenType::COMMA) {
                                 advance();
                             }
@@ -578,13 +1433,18 @@ private:
                         }
                         advance();
                         
-                        return call_method(var, member, args);
+                        Function& method = lookup_method(var, member, &tokens[member_pos]);
+                        ValuePtr result = invoke_method(method, member, arg_stack.data() + arg_base,
+                                                        arg_stack.size() - arg_base);
+                        arg_stack.resize(arg_base);
+                        return result;
                     }
                     
                     // LIST METHODS
                     if (var->type == ValueType::LIST) {
                         std::string method = member;
                         std::transform(method.begin(), method.end(), method.begin(), ::tolower);
+                        SUSA_STAT("list method", method);
                         
                         advance(); // Skip '('
                         
@@ -625,8 +1485,8 @@ private:
                             }
                             advance();
                             
-                            int index = static_cast<int>(index_val->to_number());
-                            if (index < 0 || index > static_cast<int>(var->list_value.size())) {
+                            int64_t index = index_val->to_int();
+                            if (index < 0 || index > static_cast<int64_t>(var->list_value.size())) {
                                 throw_index_error("Insert index out of range");
                             }
                             var->list_value.insert(var->list_value.begin() + index, value);
@@ -684,10 +1544,10 @@ private:
                             
                             for (size_t i = 0; i < var->list_value.size(); i++) {
                                 if (var->list_value[i]->to_number() == value->to_number()) {
-                                    return Value::make_number(i);
+                                    return Value::make_int(i);
                                 }
                             }
-                            return Value::make_number(-1);
+                            return Value::make_int(-1);
                             
                         } else {
                             throw_runtime_error("Unknown list method: " + member);
@@ -698,6 +1558,7 @@ private:
                     else if (var->type == ValueType::STRING) {
                         std::string method = member;
                         std::transform(method.begin(), method.end(), method.begin(), ::tolower);
+                        SUSA_STAT("string method", method);
                         
                         advance(); // Skip '('
                         
@@ -804,9 +1665,9 @@ private:
                             size_t pos = str.find(search);
                             
                             if (pos == std::string::npos) {
-                                return Value::make_number(-1);
+                                return Value::make_int(-1);
                             }
-                            return Value::make_number(pos);
+                            return Value::make_int(pos);
                             
                         } else {
                             throw_runtime_error("Unknown string method: " + member);
@@ -817,6 +1678,7 @@ private:
                     else if (var->type == ValueType::DICT) {
                         std::string method = member;
                         std::transform(method.begin(), method.end(), method.begin(), ::tolower);
+                        SUSA_STAT("dict method", method);
                         
                         advance(); // Skip '('
                         
@@ -827,8 +1689,9 @@ private:
                             advance();
                             
                             std::vector<ValuePtr> keys;
-                            for (const auto& pair : var->dict_value) {
-                                keys.push_back(Value::make_string(pair.first));
+                            keys.reserve(var->dict_value.size());
+                            for (const auto& entry : var->dict_value.items()) {
+                                keys.push_back(entry.key);
                             }
                             return Value::make_list(keys);
                             
@@ -839,8 +1702,9 @@ private:
                             advance();
                             
                             std::vector<ValuePtr> values;
-                            for (const auto& pair : var->dict_value) {
-                                values.push_back(pair.second);
+                            values.reserve(var->dict_value.size());
+                            for (const auto& entry : var->dict_value.items()) {
+                                values.push_back(entry.value);
                             }
                             return Value::make_list(values);
                             
@@ -851,9 +1715,21 @@ private:
                             }
                             advance();
                             
-                            std::string key = key_val->to_string();
-                            bool has = var->dict_value.find(key) != var->dict_value.end();
-                            return Value::make_bool(has);
+                            check_dict_key(key_val);
+                            return Value::make_bool(var->dict_value.contains(key_val));
+                            
+                        } else if (method == "remove") {
+                            ValuePtr key_val = evaluate_expression();
+                            if (peek().type != TokenType::RPAREN) {
+                                throw_syntax_error("Expected ')' after remove argument");
+                            }
+                            advance();
+                            
+                            check_dict_key(key_val);
+                            if (!var->dict_value.erase(key_val)) {
+                                throw_key_error(key_val->to_string());
+                            }
+                            return Value::make_null();
                             
                         } else if (method == "clear") {
                             if (peek().type != TokenType::RPAREN) {
@@ -874,9 +1750,18 @@ private:
                     // Check for instance property access
                     ValuePtr var = current_env->get(name);
                     if (var != nullptr && var->type == ValueType::INSTANCE) {
-                        // Get property from instance
-                        if (var->instance_properties.find(member) != var->instance_properties.end()) {
-                            return var->instance_properties[member];
+                        // Get property from instance (shape check, then indexed load)
+                        int slot = site_cache_slot(tokens[member_pos], property_caches);
+                        if (slot >= 0 && property_caches[slot].shape == var->shape) {
+                            return var->instance_slots[property_caches[slot].slot];
+                        }
+                        int index = var->shape->find(member);
+                        if (index != Shape::NO_SLOT) {
+                            if (slot >= 0) {
+                                property_caches[slot].shape = var->shape;
+                                property_caches[slot].slot = static_cast<uint32_t>(index);
+                            }
+                            return var->instance_slots[index];
                         }
                         throw_runtime_error("Instance has no property '" + member + "'");
                     }
@@ -897,6 +1782,7 @@ private:
             
             // Check for array/dict indexing syntax: arr[index] or dict["key"]
             if (peek().type == TokenType::LBRACKET) {
+                Token& bracket = peek();
                 advance(); // Skip '['
                 ValuePtr index_expr = evaluate_expression();
                 
@@ -906,16 +1792,33 @@ private:
                 advance(); // Skip ']'
                 
                 // Get the variable
-                ValuePtr container = current_env->get(name);
-                if (container == nullptr) {
+                ValuePtr* binding = current_env->lookup(name);
+                if (binding == nullptr) {
                     throw_name_error(name);
                 }
+                const ValuePtr& container = *binding;
+                SUSA_STAT("index", container->type == ValueType::DICT ? "dict lookup" : "list element");
+                
+                // Sites that have only indexed lists by integers go straight
+                // to the bounds check
+                TypeFeedback* feedback = feedback_site(bracket);
+                if (feedback != nullptr && *feedback != TypeFeedback::GENERIC) {
+                    bool list_index = container->type == ValueType::LIST &&
+                                      index_expr->type == ValueType::INTEGER;
+                    if (list_index && *feedback == TypeFeedback::LIST_INDEX) {
+                        int64_t index = index_expr->int_value;
+                        if (index >= 0 && index < static_cast<int64_t>(container->list_value.size())) {
+                            return container->list_value[index];
+                        }
+                    }
+                    record_feedback(*feedback, list_index ? TypeFeedback::LIST_INDEX : TypeFeedback::GENERIC);
+                }
                 
                 if (container->type == ValueType::LIST) {
-                    int index = static_cast<int>(index_expr->to_number());
+                    int64_t index = index_expr->to_int();
                     
                     // Bounds checking
-                    if (index < 0 || index >= static_cast<int>(container->list_value.size())) {
+                    if (index < 0 || index >= static_cast<int64_t>(container->list_value.size())) {
                         std::ostringstream oss;
                         oss << "List index out of range: " << index << " (size: " << container->list_value.size() << ")";
                         throw_index_error(oss.str());
@@ -923,13 +1826,13 @@ private:
                     
                     return container->list_value[index];
                 } else if (container->type == ValueType::DICT) {
-                    std::string key = index_expr->to_string();
-                    
-                    if (container->dict_value.find(key) == container->dict_value.end()) {
-                        throw_key_error(key);
+                    check_dict_key(index_expr);
+                    ValuePtr found = container->dict_value.get(index_expr);
+                    if (found == nullptr) {
+                        throw_key_error(index_expr->to_string());
                     }
                     
-                    return container->dict_value[key];
+                    return found;
                 } else {
                     throw_type_error("Cannot index non-list/dict type");
                 }
@@ -1126,7 +2029,7 @@ private:
         // Dictionary literal
         if (token.type == TokenType::LBRACE) {
             advance();
-            std::map<std::string, ValuePtr> dict;
+            Dict dict;
             
             while (peek().type != TokenType::RBRACE && peek().type != TokenType::EOF_TOKEN) {
                 // Check for spread operator
@@ -1136,19 +2039,17 @@ private:
                     
                     // Expand the dict
                     if (spread_value->type == ValueType::DICT) {
-                        for (const auto& pair : spread_value->dict_value) {
-                            dict[pair.first] = pair.second;
+                        dict.reserve(dict.size() + spread_value->dict_value.size());
+                        for (const auto& entry : spread_value->dict_value.items()) {
+                            dict.set(entry.key, entry.value);
                         }
                     } else {
                         throw_type_error("Spread operator requires a dict");
                     }
                 } else {
-                    // Parse key (must be string)
-                    if (peek().type != TokenType::STRING) {
-                        throw_syntax_error("Dictionary key must be a string");
-                    }
-                    std::string key = peek().value;
-                    advance();
+                    // Parse key (string, number or boolean)
+                    ValuePtr key = evaluate_expression();
+                    check_dict_key(key);
                     
                     if (peek().type != TokenType::COLON) {
                         throw_syntax_error("Expected ':' after dictionary key");
@@ -1157,7 +2058,7 @@ private:
                     
                     // Parse value
                     ValuePtr value = evaluate_expression();
-                    dict[key] = value;
+                    dict.set(key, value);
                 }
                 
                 if (peek().type == TokenType::COMMA) {
@@ -1200,8 +2101,14 @@ private:
             throw_runtime_error(oss.str());
         }
         
+        static const std::string lambda_name = "<lambda>";
+        ProfileScope profile_scope(profiler, tracer, Profiler::Kind::LAMBDA, lambda_name);
+        run_stats.calls++;
+        SUSA_STAT("call", lambda_name);
+        budget_tick();
+        
         // Create new environment for lambda execution
-        auto lambda_env = std::make_shared<Environment>(current_env);
+        std::shared_ptr<Environment> lambda_env = acquire_frame(current_env);
         
         // Bind parameters
         for (size_t i = 0; i < lambda->lambda_params.size(); i++) {
@@ -1216,17 +2123,22 @@ private:
         Lexer body_lexer(lambda->lambda_body);
         auto body_tokens = body_lexer.tokenize();
         
-        auto saved_tokens = tokens;
+        std::vector<Token> saved_tokens;
+        saved_tokens.swap(tokens);
         auto saved_current = current;
         
-        tokens = body_tokens;
+        tokens = std::move(body_tokens);
         current = 0;
+        bool saved_site_caching = site_caching;
+        site_caching = false;
         
         ValuePtr result = evaluate_expression();
         
-        tokens = saved_tokens;
+        site_caching = saved_site_caching;
+        tokens.swap(saved_tokens);
         current = saved_current;
         current_env = saved_env;
+        release_frame(lambda_env);
         
         return result;
     }
@@ -1256,6 +2168,9 @@ private:
         // Try to call builtin module function
         auto func = builtin_modules.get_function(module_name, func_name);
         if (func) {
+            ProfileScope profile_scope(profiler, tracer, Profiler::Kind::BUILTIN, func_name, &module_name);
+            run_stats.builtin_calls++;
+            SUSA_STAT("builtin", module_name + "." + func_name);
             return func(args);
         }
         
@@ -1281,9 +2196,10 @@ private:
     ValuePtr evaluate_function_call(const std::string& name) {
         advance(); // Skip '('
         
-        std::vector<ValuePtr> args;
+        size_t arg_base = arg_stack.size();
         while (peek().type != TokenType::RPAREN && peek().type != TokenType::EOF_TOKEN) {
-            args.push_back(evaluate_expression());
+            ValuePtr arg = evaluate_expression();
+            arg_stack.push_back(std::move(arg));
             if (peek().type == TokenType::COMMA) {
                 advance();
             }
@@ -1294,16 +2210,26 @@ private:
         }
         advance();
         
+        // Check for user-defined functions
+        auto func_it = functions.find(name);
+        if (func_it != functions.end() && classes.find(name) == classes.end()) {
+            ValuePtr result = call_function(func_it->second, name, arg_stack.data() + arg_base,
+                                            arg_stack.size() - arg_base);
+            arg_stack.resize(arg_base);
+            return result;
+        }
+        
+        std::vector<ValuePtr> args(arg_stack.begin() + arg_base, arg_stack.end());
+        arg_stack.resize(arg_base);
+        
         // Check for class instantiation
         if (classes.find(name) != classes.end()) {
             return instantiate_class(name, args);
         }
         
-        // Check for user-defined functions
-        if (functions.find(name) != functions.end()) {
-            return call_user_function(name, args);
-        }
-        
+        ProfileScope profile_scope(profiler, tracer, Profiler::Kind::BUILTIN, name);
+        run_stats.builtin_calls++;
+        SUSA_STAT("builtin", name);
         return call_builtin_function(name, args);
     }
     
@@ -1365,11 +2291,13 @@ private:
         if (lower_name == "len") {
             if (args.size() != 1) throw_argument_error("len", 1, args.size());
             if (args[0]->type == ValueType::STRING) {
-                return Value::make_number(args[0]->string_value.length());
+                return Value::make_int(args[0]->string_value.length());
             } else if (args[0]->type == ValueType::LIST) {
-                return Value::make_number(args[0]->list_value.size());
+                return Value::make_int(args[0]->list_value.size());
+            } else if (args[0]->type == ValueType::DICT) {
+                return Value::make_int(args[0]->dict_value.size());
             }
-            throw_type_error("len() requires a string or list");
+            throw_type_error("len() requires a string, list or dict");
         }
         if (lower_name == "upper") {
             if (args.size() != 1) throw_argument_error("upper", 1, args.size());
@@ -1395,17 +2323,17 @@ private:
         // NUMBERS(start, end) - from start to end-1
         // NUMBERS(start, end, step) - from start to end-1 with step
         if (lower_name == "numbers" || lower_name == "sequence" || lower_name == "range") {
-            int start = 0, end = 0, step = 1;
+            int64_t start = 0, end = 0, step = 1;
             
             if (args.size() == 1) {
-                end = static_cast<int>(args[0]->to_number());
+                end = args[0]->to_int();
             } else if (args.size() == 2) {
-                start = static_cast<int>(args[0]->to_number());
-                end = static_cast<int>(args[1]->to_number());
+                start = args[0]->to_int();
+                end = args[1]->to_int();
             } else if (args.size() == 3) {
-                start = static_cast<int>(args[0]->to_number());
-                end = static_cast<int>(args[1]->to_number());
-                step = static_cast<int>(args[2]->to_number());
+                start = args[0]->to_int();
+                end = args[1]->to_int();
+                step = args[2]->to_int();
             } else {
                 throw_argument_error("NUMBERS", 1, args.size());
             }
@@ -1416,12 +2344,12 @@ private:
             
             std::vector<ValuePtr> result;
             if (step > 0) {
-                for (int i = start; i < end; i += step) {
-                    result.push_back(Value::make_number(i));
+                for (int64_t i = start; i < end; i += step) {
+                    result.push_back(Value::make_int(i));
                 }
             } else {
-                for (int i = start; i > end; i += step) {
-                    result.push_back(Value::make_number(i));
+                for (int64_t i = start; i > end; i += step) {
+                    result.push_back(Value::make_int(i));
                 }
             }
             
@@ -1435,7 +2363,7 @@ private:
         }
         if (lower_name == "int") {
             if (args.size() != 1) throw_argument_error("int", 1, args.size());
-            return Value::make_number(static_cast<int>(args[0]->to_number()));
+            return Value::make_int(args[0]->to_int());
         }
         if (lower_name == "float") {
             if (args.size() != 1) throw_argument_error("float", 1, args.size());
@@ -1445,6 +2373,475 @@ private:
         throw std::runtime_error("Unknown function: " + name);
     }
     
+    // Record (or clear, for LET/CONST) the declared type of a variable
+    void declare_variable_type(const std::string& name, TokenType keyword) {
+        switch (keyword) {
+            case TokenType::INT:
+                current_env->declare(name, ValueType::INTEGER);
+                break;
+            case TokenType::FLOAT:
+            case TokenType::DOUBLE:
+                current_env->declare(name, ValueType::NUMBER);
+                break;
+            case TokenType::BOOL:
+                current_env->declare(name, ValueType::BOOLEAN);
+                break;
+            case TokenType::STRING_TYPE:
+            case TokenType::CHAR:
+                current_env->declare(name, ValueType::STRING);
+                break;
+            default:
+                current_env->undeclare(name);
+                break;
+        }
+    }
+    
+    // Compound assignment on a declared INT/FLOAT variable with a matching
+    // operand: mutate the stored value instead of allocating a new one.
+    // Returns false when the generic path has to handle it.
+    bool update_typed_in_place(const std::string& name, TokenType op, const ValuePtr& right) {
+        ValueType declared;
+        Value* slot = current_env->typed_slot(name, declared);
+        if (slot == nullptr) {
+            return false;
+        }
+        
+        if (declared == ValueType::INTEGER && right->type == ValueType::INTEGER) {
+            int64_t result;
+            bool ok = false;
+            switch (op) {
+                case TokenType::PLUS_ASSIGN: ok = checked_add(slot->int_value, right->int_value, result); break;
+                case TokenType::MINUS_ASSIGN: ok = checked_sub(slot->int_value, right->int_value, result); break;
+                case TokenType::MULT_ASSIGN: ok = checked_mul(slot->int_value, right->int_value, result); break;
+                default: break;
+            }
+            if (ok) {
+                slot->int_value = result;
+            }
+            return ok;
+        }
+        
+        if (declared == ValueType::NUMBER && right->is_numeric()) {
+            double right_num = right->to_number();
+            switch (op) {
+                case TokenType::PLUS_ASSIGN: slot->number_value += right_num; return true;
+                case TokenType::MINUS_ASSIGN: slot->number_value -= right_num; return true;
+                case TokenType::MULT_ASSIGN: slot->number_value *= right_num; return true;
+                case TokenType::DIV_ASSIGN:
+                    if (right_num == 0) throw_zero_division_error();
+                    slot->number_value /= right_num;
+                    return true;
+                default: return false;
+            }
+        }
+        
+        return false;
+    }
+    
+    // Fused-operation record for a site token (nullptr when caching is off)
+    FusedOp* fused_site(Token& head) {
+        int slot = site_cache_slot(head, fused_ops);
+        return slot < 0 ? nullptr : &fused_ops[slot];
+    }
+    
+    // Record a NUMBER or IDENTIFIER operand at `offset` from the current
+    // token; literals are parsed once into the op's constant
+    bool decode_fused_operand(int offset, FusedOp& op) {
+        const Token& operand = peek(offset);
+        if (operand.type == TokenType::NUMBER) {
+            op.constant = number_literal_value(operand.value);
+            return true;
+        }
+        return operand.type == TokenType::IDENTIFIER;
+    }
+    
+    static bool ends_fused_statement(TokenType type) {
+        return type == TokenType::NEWLINE || type == TokenType::EOF_TOKEN;
+    }
+    
+    // Statement shapes, with the current token at the assigned name
+    void decode_fused_statement(FusedOp& op) {
+        op.decoded = true;
+        TokenType next = peek(1).type;
+        
+        if ((next == TokenType::INCREMENT || next == TokenType::DECREMENT) &&
+            ends_fused_statement(peek(2).type)) {
+            op.kind = FusedKind::INCREMENT;
+            op.op = next == TokenType::INCREMENT ? TokenType::PLUS : TokenType::MINUS;
+            op.constant = Value::make_int(1);
+            op.length = 2;
+        } else if ((next == TokenType::PLUS_ASSIGN || next == TokenType::MINUS_ASSIGN) &&
+                   peek(2).type == TokenType::NUMBER && ends_fused_statement(peek(3).type)) {
+            op.kind = FusedKind::INCREMENT;
+            op.op = next == TokenType::PLUS_ASSIGN ? TokenType::PLUS : TokenType::MINUS;
+            op.constant = number_literal_value(peek(2).value);
+            op.length = 3;
+        } else if (next == TokenType::PLUS_ASSIGN && peek(2).type == TokenType::IDENTIFIER &&
+                   peek(3).type == TokenType::LBRACKET && peek(5).type == TokenType::RBRACKET &&
+                   ends_fused_statement(peek(6).type) && decode_fused_operand(4, op)) {
+            op.kind = FusedKind::ACCUMULATE_INDEXED;
+            op.length = 6;
+        } else if (next == TokenType::ASSIGN && peek(2).type == TokenType::IDENTIFIER &&
+                   peek(2).value == peek().value && peek(3).type == TokenType::PLUS &&
+                   peek(4).type == TokenType::IDENTIFIER && peek(5).type == TokenType::LBRACKET &&
+                   peek(7).type == TokenType::RBRACKET && ends_fused_statement(peek(8).type) &&
+                   decode_fused_operand(6, op)) {
+            op.kind = FusedKind::ACCUMULATE_INDEXED;
+            op.length = 8;
+        }
+    }
+    
+    // Local a fused statement may overwrite directly: bound in the current
+    // scope, not CONST, and untyped or declared INT/FLOAT. `declared` is the
+    // declared type (NULL_TYPE when there is none); the caller must only
+    // store values of that type.
+    ValuePtr* fusible_local(const std::string& name, ValueType& declared) {
+        Environment& env = *current_env;
+        if (!env.const_flags.empty() && env.const_flags.count(name) != 0) {
+            return nullptr;
+        }
+        declared = ValueType::NULL_TYPE;
+        if (!env.declared_types.empty()) {
+            auto typed = env.declared_types.find(name);
+            if (typed != env.declared_types.end()) {
+                if (typed->second != ValueType::INTEGER && typed->second != ValueType::NUMBER) {
+                    return nullptr;
+                }
+                declared = typed->second;
+            }
+        }
+        return env.find_local(name);
+    }
+    
+    // Store an arithmetic result, reusing the Value when nothing else holds it
+    static void store_int(ValuePtr& slot, int64_t result) {
+        if (slot.use_count() == 1 && slot->type == ValueType::INTEGER) {
+            slot->int_value = result;
+        } else {
+            slot = Value::make_int(result);
+        }
+    }
+    
+    static void store_number(ValuePtr& slot, double result) {
+        if (slot.use_count() == 1 && slot->type == ValueType::NUMBER) {
+            slot->number_value = result;
+        } else {
+            slot = Value::make_number(result);
+        }
+    }
+    
+    // slot += delta (or -=) for numeric operands; false when it can't be done
+    // here (non-numeric operand or int64 overflow)
+    static bool fused_add(ValuePtr& slot, const Value& delta, TokenType op) {
+        const Value& value = *slot;
+        if (value.type == ValueType::INTEGER && delta.type == ValueType::INTEGER) {
+            int64_t result;
+            bool ok = op == TokenType::PLUS ? checked_add(value.int_value, delta.int_value, result)
+                                            : checked_sub(value.int_value, delta.int_value, result);
+            if (ok) {
+                store_int(slot, result);
+            }
+            return ok;
+        }
+        if (value.is_numeric() && delta.is_numeric()) {
+            double result = op == TokenType::PLUS ? value.to_number() + delta.to_number()
+                                                  : value.to_number() - delta.to_number();
+            store_number(slot, result);
+            return true;
+        }
+        return false;
+    }
+    
+    // Variable or literal operand of a fused op at token `pos`
+    const ValuePtr* fused_operand(size_t pos, const FusedOp& op) {
+        if (op.constant != nullptr) {
+            return &op.constant;
+        }
+        return current_env->lookup(tokens[pos].value);
+    }
+    
+    // list[index] for the list name at token `pos` (nullptr unless it is an
+    // in-range integer index into a list)
+    const ValuePtr* fused_list_element(size_t pos, const FusedOp& op) {
+        ValuePtr* list = current_env->lookup(tokens[pos].value);
+        const ValuePtr* index = fused_operand(pos + 2, op);
+        if (list == nullptr || index == nullptr || (*list)->type != ValueType::LIST ||
+            (*index)->type != ValueType::INTEGER) {
+            return nullptr;
+        }
+        int64_t i = (*index)->int_value;
+        if (i < 0 || i >= static_cast<int64_t>((*list)->list_value.size())) {
+            return nullptr;
+        }
+        return &(*list)->list_value[i];
+    }
+    
+    // Run the statement at `head` as a superinstruction; false leaves the
+    // position untouched for the generic path
+    bool execute_fused_statement(Token& head) {
+        TokenType next = peek(1).type;
+        if (next != TokenType::ASSIGN && next != TokenType::PLUS_ASSIGN &&
+            next != TokenType::MINUS_ASSIGN && next != TokenType::INCREMENT &&
+            next != TokenType::DECREMENT) {
+            return false;
+        }
+        FusedOp* op = fused_site(head);
+        if (op == nullptr) {
+            return false;
+        }
+        if (!op->decoded) {
+            decode_fused_statement(*op);
+        }
+        if (op->kind == FusedKind::NONE) {
+            return false;
+        }
+        
+        ValueType declared;
+        ValuePtr* target = fusible_local(head.value, declared);
+        if (target == nullptr) {
+            return false;
+        }
+        
+        // A declared FLOAT stays FLOAT whatever is added; a declared INT only
+        // when the operand is an INT too
+        if (op->kind == FusedKind::INCREMENT) {
+            if ((declared == ValueType::INTEGER && op->constant->type != ValueType::INTEGER) ||
+                !fused_add(*target, *op->constant, op->op)) {
+                return false;
+            }
+        } else if (op->kind == FusedKind::ACCUMULATE_INDEXED) {
+            const ValuePtr* element = fused_list_element(current + op->length - 4, *op);
+            if (element == nullptr ||
+                (declared == ValueType::INTEGER && (*element)->type != ValueType::INTEGER) ||
+                !fused_add(*target, **element, TokenType::PLUS)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+        
+        current += op->length;
+        skip_newlines();
+        return true;
+    }
+    
+    // x[i] / x[3] in an expression, with the current token at the list name;
+    // nullptr leaves it to the generic indexing path
+    ValuePtr evaluate_fused_index(Token& head) {
+        FusedOp* op = fused_site(head);
+        if (op == nullptr) {
+            return nullptr;
+        }
+        if (!op->decoded) {
+            op->decoded = true;
+            if (peek(3).type == TokenType::RBRACKET && decode_fused_operand(2, *op)) {
+                op->kind = FusedKind::LOAD_INDEXED;
+                op->length = 4;
+            }
+        }
+        if (op->kind != FusedKind::LOAD_INDEXED) {
+            return nullptr;
+        }
+        
+        const ValuePtr* element = fused_list_element(current, *op);
+        if (element == nullptr) {
+            return nullptr;
+        }
+        SUSA_STAT("index", "list element");
+        current += op->length;
+        return *element;
+    }
+    
+    // Truth value of a WHILE / LOOP WHILE / IF condition starting at the
+    // current token, `head` being the keyword before it. A lone comparison
+    // of a variable against a literal or variable (i < n:) is evaluated
+    // without going through the expression ladder or allocating a result.
+    // It needs no type guard: compare_values() is what the generic path
+    // ends in too, so operands of any type compare exactly as before.
+    bool evaluate_condition(Token& head) {
+        FusedOp* op = fused_site(head);
+        if (op != nullptr) {
+            if (!op->decoded) {
+                op->decoded = true;
+                TokenType compare = peek(1).type;
+                if (peek().type == TokenType::IDENTIFIER && peek(3).type == TokenType::COLON &&
+                    (compare == TokenType::LESS || compare == TokenType::LESS_EQUAL ||
+                     compare == TokenType::GREATER || compare == TokenType::GREATER_EQUAL ||
+                     compare == TokenType::EQUAL || compare == TokenType::NOT_EQUAL) &&
+                    decode_fused_operand(2, *op)) {
+                    op->kind = FusedKind::COMPARE;
+                    op->op = compare;
+                    op->length = 3;
+                }
+            }
+            if (op->kind == FusedKind::COMPARE) {
+                ValuePtr* left = current_env->lookup(peek().value);
+                const ValuePtr* right = fused_operand(current + 2, *op);
+                if (left != nullptr && right != nullptr) {
+                    SUSA_STAT("compare", tokens[current + 1].value);
+                    current += op->length;
+                    return compare_values(op->op, *left, *right);
+                }
+            }
+        }
+        return evaluate_expression()->is_truthy();
+    }
+    
+    // JIT site index of the loop closed by `end_token` (-1 when not compiling).
+    // An index rather than a pointer: nested loops may grow jit_sites.
+    int jit_site(Token& end_token) {
+        return jit ? site_cache_slot(end_token, jit_sites) : -1;
+    }
+    
+    // Run the rest of a hot loop natively, starting at an iteration boundary.
+    // The compiled loop spends the current budget slice as its iteration
+    // allowance.
+    JitRun run_hot_loop(int site_index, size_t condition_start, size_t block_start,
+                        size_t block_end) {
+        JitLoopSite& site = jit_sites[site_index];
+        if (++site.iterations < JIT_HOT_ITERATIONS) {
+            return JitRun::NOT_RUN;
+        }
+        if (!site.compiled) {
+            site.compiled = true;
+            auto compile_start = std::chrono::steady_clock::now();
+            site.loop = compile_loop(tokens, condition_start, block_start, block_end,
+                [this](const std::string& name, JitType& type) {
+                    ValuePtr* binding = current_env->lookup(name);
+                    if (binding == nullptr) {
+                        return false;
+                    }
+                    if ((*binding)->type == ValueType::INTEGER) {
+                        type = JitType::INT;
+                        return true;
+                    }
+                    if ((*binding)->type == ValueType::NUMBER) {
+                        type = JitType::DOUBLE;
+                        return true;
+                    }
+                    return false;
+                });
+            run_stats.jit_compile_ms += elapsed_ms(compile_start);
+        }
+        if (site.loop == nullptr) {
+            return JitRun::NOT_RUN;
+        }
+        
+        // Entry guards: bind every slot in this scope with its compiled type.
+        // Compiled code only stores a slot's own type, so a declared INT/FLOAT
+        // local keeps its type; one a LET in the loop would undeclare can't
+        // be compiled.
+        const std::vector<JitSlot>& slots = site.loop->frame_slots();
+        jit_frame.resize(slots.size() + 1);
+        jit_bindings.resize(slots.size());
+        for (size_t i = 0; i < slots.size(); i++) {
+            ValueType declared = ValueType::NULL_TYPE;
+            ValuePtr* binding = slots[i].written ? fusible_local(slots[i].name, declared)
+                                                 : current_env->lookup(slots[i].name);
+            ValueType expected = slots[i].type == JitType::INT ? ValueType::INTEGER : ValueType::NUMBER;
+            if (binding == nullptr || (*binding)->type != expected ||
+                (slots[i].redeclared && declared != ValueType::NULL_TYPE)) {
+                site.iterations = 0;
+                return JitRun::NOT_RUN;
+            }
+            jit_bindings[i] = binding;
+            if (expected == ValueType::INTEGER) {
+                jit_frame[i] = (*binding)->int_value;
+            } else {
+                std::memcpy(&jit_frame[i], &(*binding)->number_value, sizeof(double));
+            }
+        }
+        jit_frame[slots.size()] = budget_ticks;
+        
+        int64_t exit = site.loop->run(jit_frame.data());
+        
+        budget_ticks = jit_frame[slots.size()];
+        for (size_t i = 0; i < slots.size(); i++) {
+            if (!slots[i].written) {
+                continue;
+            }
+            if (slots[i].type == JitType::INT) {
+                store_int(*jit_bindings[i], jit_frame[i]);
+            } else {
+                double value;
+                std::memcpy(&value, &jit_frame[i], sizeof(double));
+                store_number(*jit_bindings[i], value);
+            }
+        }
+        
+        if (exit == CompiledLoop::EXIT_DONE) {
+            return JitRun::FINISHED;
+        }
+        if (exit == CompiledLoop::EXIT_LIMIT) {
+            check_budget();
+            return JitRun::ITERATION;
+        }
+        
+        // A guard failed: the interpreter takes over (for good after too many)
+        size_t resume = exit == CompiledLoop::EXIT_CONDITION ? 0 : site.loop->resume_position(exit);
+        if (++site.deopts >= JIT_MAX_DEOPTS) {
+            site.loop.reset();
+        }
+        if (exit == CompiledLoop::EXIT_CONDITION) {
+            return JitRun::NOT_RUN;
+        }
+        
+        // Finish the iteration from the failed statement; reaching the END:
+        // of an enclosing IF just continues after it
+        current = resume;
+        while (current < block_end) {
+            if (peek().type == TokenType::END && peek(1).type == TokenType::COLON) {
+                advance(); advance();
+                skip_newlines();
+                continue;
+            }
+            execute_statement();
+        }
+        budget_tick();
+        return JitRun::ITERATION;
+    }
+    
+#ifdef SUSA_STATS
+    // Statement kind for the --stats histogram: the keyword, or for one
+    // starting with a name what follows it
+    void count_statement(const Token& token) {
+        if (token.type != TokenType::IDENTIFIER) {
+            std::string keyword = token.value;
+            std::transform(keyword.begin(), keyword.end(), keyword.begin(), ::toupper);
+            op_stats->count("statement", keyword);
+            return;
+        }
+        const Token& next = peek(1);
+        switch (next.type) {
+            case TokenType::ASSIGN:
+                op_stats->count("assign", "variable");
+                break;
+            case TokenType::PLUS_ASSIGN:
+            case TokenType::MINUS_ASSIGN:
+            case TokenType::MULT_ASSIGN:
+            case TokenType::DIV_ASSIGN:
+            case TokenType::MOD_ASSIGN:
+            case TokenType::POW_ASSIGN:
+            case TokenType::INCREMENT:
+            case TokenType::DECREMENT:
+                op_stats->count("compound assign", next.value);
+                break;
+            case TokenType::LBRACKET:
+                op_stats->count("statement", "name[...] (index assignment)");
+                break;
+            case TokenType::DOT:
+                op_stats->count("statement", "name.member (method call or property)");
+                break;
+            case TokenType::LPAREN:
+                op_stats->count("statement", "call");
+                break;
+            default:
+                op_stats->count("statement", "expression");
+                break;
+        }
+    }
+#endif
+    
     // Statement execution
     void execute_statement() {
         skip_newlines();
@@ -1454,6 +2851,17 @@ private:
         }
         
         Token& token = peek();
+        if (profiler != nullptr && site_caching) {
+            profiler->line_hit(token.line);
+        }
+        if (SamplingProfiler::pending()) {
+            take_sample();
+        }
+#ifdef SUSA_STATS
+        if (op_stats != nullptr) {
+            count_statement(token);
+        }
+#endif
         
         // ADD statement (module import)
         if (token.type == TokenType::ADD) {
@@ -1498,7 +2906,28 @@ private:
         // RETURN statement
         if (token.type == TokenType::RETURN) {
             advance();
-            return_value = evaluate_expression();
+            const std::string* callee_name = nullptr;
+            Function* callee = tail_call_target(callee_name);
+            if (callee != nullptr) {
+                advance(); advance(); // Skip name and '('
+                size_t arg_base = arg_stack.size();
+                while (peek().type != TokenType::RPAREN && peek().type != TokenType::EOF_TOKEN) {
+                    ValuePtr arg = evaluate_expression();
+                    arg_stack.push_back(std::move(arg));
+                    if (peek().type == TokenType::COMMA) {
+                        advance();
+                    }
+                }
+                advance(); // Skip ')'
+                tail_args.assign(std::make_move_iterator(arg_stack.begin() + arg_base),
+                                 std::make_move_iterator(arg_stack.end()));
+                arg_stack.resize(arg_base);
+                tail_call = callee;
+                tail_call_name = callee_name;
+                return_value = null_value;
+            } else {
+                return_value = evaluate_expression();
+            }
             return_flag = true;
             skip_newlines();
             return;
@@ -1535,6 +2964,11 @@ private:
             return;
         }
         
+        // Loop idioms (i += 1, i++, total = total + x[i]) as superinstructions
+        if (token.type == TokenType::IDENTIFIER && execute_fused_statement(token)) {
+            return;
+        }
+        
         // Variable assignment (including CONST and destructuring)
         if (token.type == TokenType::LET || token.type == TokenType::CONST_VAR ||
             token.type == TokenType::INT || token.type == TokenType::STRING_TYPE || 
@@ -1543,6 +2977,7 @@ private:
             token.type == TokenType::IDENTIFIER) {
             size_t saved_pos = current;
             bool is_const = false;
+            TokenType decl_keyword = token.type;
             
             if (token.type == TokenType::CONST_VAR) {
                 is_const = true;
@@ -1647,6 +3082,7 @@ private:
                 
                 // Single variable - continue with normal assignment
                 std::string var_name = var_names[0];
+                bool is_declaration = decl_keyword != TokenType::IDENTIFIER;
                 
                 // Check for property assignment: instance.property = value
                 if (peek().type == TokenType::DOT) {
@@ -1676,7 +3112,7 @@ private:
                             }
                             
                             // Set property
-                            instance->instance_properties[property_name] = value;
+                            instance->set_property(property_name, value);
                             skip_newlines();
                             return;
                         }
@@ -1708,14 +3144,22 @@ private:
                         throw_name_error(var_name);
                     }
                     
+                    SUSA_STAT("index", arr->type == ValueType::DICT ? "dict store" : "list store");
+                    if (arr->type == ValueType::DICT) {
+                        check_dict_key(index_expr);
+                        arr->dict_value.set(index_expr, value);
+                        skip_newlines();
+                        return;
+                    }
+                    
                     if (arr->type != ValueType::LIST) {
                         throw_type_error("Cannot index non-list type");
                     }
                     
-                    int index = static_cast<int>(index_expr->to_number());
+                    int64_t index = index_expr->to_int();
                     
                     // Bounds checking
-                    if (index < 0 || index >= static_cast<int>(arr->list_value.size())) {
+                    if (index < 0 || index >= static_cast<int64_t>(arr->list_value.size())) {
                         std::ostringstream oss;
                         oss << "List index out of range: " << index << " (size: " << arr->list_value.size() << ")";
                         throw_index_error(oss.str());
@@ -1729,6 +3173,9 @@ private:
                 if (peek().type == TokenType::ASSIGN) {
                     advance();
                     ValuePtr value = evaluate_expression();
+                    if (is_declaration) {
+                        declare_variable_type(var_name, decl_keyword);
+                    }
                     current_env->set(var_name, value, is_const);  // Pass const flag
                     skip_newlines();
                     return;
@@ -1741,39 +3188,28 @@ private:
                     TokenType op = peek().type;
                     advance();
                     ValuePtr right = evaluate_expression();
+                    
+                    if (update_typed_in_place(var_name, op, right)) {
+                        skip_newlines();
+                        return;
+                    }
+                    
                     ValuePtr left = current_env->get(var_name);
                     
                     if (left == nullptr) {
                         throw_name_error(var_name);
                     }
                     
-                    ValuePtr result;
-                    double left_num = left->to_number();
-                    double right_num = right->to_number();
-                    
+                    TokenType arith_op = TokenType::PLUS;
                     switch (op) {
-                        case TokenType::PLUS_ASSIGN:
-                            result = Value::make_number(left_num + right_num);
-                            break;
-                        case TokenType::MINUS_ASSIGN:
-                            result = Value::make_number(left_num - right_num);
-                            break;
-                        case TokenType::MULT_ASSIGN:
-                            result = Value::make_number(left_num * right_num);
-                            break;
-                        case TokenType::DIV_ASSIGN:
-                            if (right_num == 0) throw_runtime_error("Division by zero");
-                            result = Value::make_number(left_num / right_num);
-                            break;
-                        case TokenType::MOD_ASSIGN:
-                            result = Value::make_number(std::fmod(left_num, right_num));
-                            break;
-                        case TokenType::POW_ASSIGN:
-                            result = Value::make_number(std::pow(left_num, right_num));
-                            break;
-                        default:
-                            result = left;
+                        case TokenType::MINUS_ASSIGN: arith_op = TokenType::MINUS; break;
+                        case TokenType::MULT_ASSIGN: arith_op = TokenType::MULTIPLY; break;
+                        case TokenType::DIV_ASSIGN: arith_op = TokenType::DIVIDE; break;
+                        case TokenType::MOD_ASSIGN: arith_op = TokenType::MODULO; break;
+                        case TokenType::POW_ASSIGN: arith_op = TokenType::POWER; break;
+                        default: break;
                     }
+                    ValuePtr result = apply_arithmetic(arith_op, left, right);
                     
                     current_env->set(var_name, result);
                     skip_newlines();
@@ -1784,15 +3220,22 @@ private:
                 if (peek().type == TokenType::INCREMENT || peek().type == TokenType::DECREMENT) {
                     TokenType op = peek().type;
                     advance();
+                    
+                    static const ValuePtr one = Value::make_int(1);
+                    TokenType step_op = (op == TokenType::INCREMENT) ? TokenType::PLUS_ASSIGN : TokenType::MINUS_ASSIGN;
+                    if (update_typed_in_place(var_name, step_op, one)) {
+                        skip_newlines();
+                        return;
+                    }
+                    
                     ValuePtr current_val = current_env->get(var_name);
                     
                     if (current_val == nullptr) {
                         throw_name_error(var_name);
                     }
                     
-                    double num = current_val->to_number();
-                    ValuePtr new_val = (op == TokenType::INCREMENT) ? 
-                        Value::make_number(num + 1) : Value::make_number(num - 1);
+                    ValuePtr new_val = apply_arithmetic(
+                        op == TokenType::INCREMENT ? TokenType::PLUS : TokenType::MINUS, current_val, one);
                     
                     current_env->set(var_name, new_val);
                     skip_newlines();
@@ -1890,6 +3333,7 @@ private:
         
         std::string module_name = peek().value;
         advance();
+        TraceSpan import_span(tracer, "import", module_name);
         
         // Check for AS alias
         std::string alias = module_name;
@@ -1914,8 +3358,9 @@ private:
     }
     
     void execute_if_statement() {
+        Token& if_token = peek();
         advance(); // Skip 'if'
-        ValuePtr condition = evaluate_expression();
+        bool condition = evaluate_condition(if_token);
         
         if (peek().type != TokenType::COLON) {
             throw std::runtime_error("Expected ':' after if condition");
@@ -1957,7 +3402,7 @@ private:
         skip_newlines();
         
         // Execute block if condition is true
-        if (condition->is_truthy()) {
+        if (condition) {
             current = block_start;
             
             while (current < block_end && !break_flag && !continue_flag) {
@@ -2016,15 +3461,18 @@ private:
         skip_newlines();
         
         // Execute loop
-        int max_iterations = 100000;
-        int iterations = 0;
+        int hot = jit_site(tokens[after_block]);
         
-        while (iterations < max_iterations) {
+        while (true) {
+            if (hot >= 0) {
+                JitRun run = run_hot_loop(hot, condition_start, block_start, block_end);
+                if (run == JitRun::FINISHED) break;
+                if (run == JitRun::ITERATION) continue;
+            }
+            
             // Evaluate condition
             current = condition_start;
-            ValuePtr condition = evaluate_expression();
-            
-            if (!condition->is_truthy()) break;
+            if (!evaluate_condition(tokens[condition_start - 1])) break;
             
             // Execute block
             current = block_start;
@@ -2045,7 +3493,7 @@ private:
                 break;
             }
             
-            iterations++;
+            budget_tick();
         }
         
         current = after_block + 2;
@@ -2128,6 +3576,7 @@ private:
                     break_flag = false;
                     break;
                 }
+                budget_tick();
             }
         } else if (iterable->type == ValueType::GENERATOR) {
             // Iterate over generator values
@@ -2150,6 +3599,7 @@ private:
                     break_flag = false;
                     break;
                 }
+                budget_tick();
             }
         }
         
@@ -2209,15 +3659,18 @@ private:
             skip_newlines();
             
             // Execute loop
-            int max_iterations = 100000;
-            int iterations = 0;
+            int hot = jit_site(tokens[after_block]);
             
-            while (iterations < max_iterations) {
+            while (true) {
+                if (hot >= 0) {
+                    JitRun run = run_hot_loop(hot, condition_start, block_start, block_end);
+                    if (run == JitRun::FINISHED) break;
+                    if (run == JitRun::ITERATION) continue;
+                }
+                
                 // Evaluate condition
                 current = condition_start;
-                ValuePtr condition = evaluate_expression();
-                
-                if (!condition->is_truthy()) break;
+                if (!evaluate_condition(tokens[condition_start - 1])) break;
                 
                 // Execute block
                 current = block_start;
@@ -2238,7 +3691,7 @@ private:
                     break;
                 }
                 
-                iterations++;
+                budget_tick();
             }
             
             current = after_block + 2;
@@ -2257,7 +3710,7 @@ private:
             if (peek().type == TokenType::ASSIGN) {
                 advance();
                 if (peek().type == TokenType::NUMBER) {
-                    start_val = static_cast<int>(std::stod(peek().value));
+                    start_val = static_cast<int>(parse_number_literal(peek().value));
                     advance();
                 }
             }
@@ -2271,7 +3724,7 @@ private:
         if (peek().type != TokenType::NUMBER) {
             throw std::runtime_error("Expected number of iterations");
         }
-        int iterations = static_cast<int>(std::stod(peek().value));
+        int iterations = static_cast<int>(parse_number_literal(peek().value));
         advance();
         
         if (peek().type != TokenType::TIMES) {
@@ -2321,7 +3774,13 @@ private:
         // Execute loop
         for (int i = 0; i < iterations; i++) {
             if (!var_name.empty()) {
-                current_env->set(var_name, Value::make_number(start_val + i));
+                ValueType declared;
+                ValuePtr* counter = fusible_local(var_name, declared);
+                if (counter != nullptr && declared != ValueType::NUMBER) {
+                    store_int(*counter, start_val + i);
+                } else {
+                    current_env->set(var_name, Value::make_int(start_val + i));
+                }
             }
             
             current = block_start;
@@ -2341,6 +3800,7 @@ private:
                 break_flag = false;
                 break;
             }
+            budget_tick();
         }
         
         current = after_block + 2;
@@ -2437,10 +3897,7 @@ private:
         skip_newlines();
         
         // Execute loop (at least once)
-        int max_iterations = 100000;
-        int iterations = 0;
-        
-        do {
+        while (true) {
             // Execute block
             current = block_start;
             break_flag = false;
@@ -2466,15 +3923,142 @@ private:
             
             if (!condition->is_truthy()) break;
             
-            iterations++;
-        } while (iterations < max_iterations);
+            budget_tick();
+        }
         
         current = after_condition;
         skip_newlines();
     }
     
     // SWITCH statement
+    // Strings match by content, anything else by numeric value
+    static bool switch_matches(const ValuePtr& switch_value, const ValuePtr& case_value) {
+        if (switch_value->type == ValueType::STRING && case_value->type == ValueType::STRING) {
+            return switch_value->string_value == case_value->string_value;
+        }
+        return switch_value->to_number() == case_value->to_number();
+    }
+    
+    static double switch_key(double number) {
+        return number == 0 ? 0.0 : number;  // -0.0 and 0.0 share a bucket
+    }
+    
+    // Index of the END: matching the block whose body starts at `pos`
+    size_t find_block_end(size_t pos) {
+        int depth = 1;
+        while (pos + 1 < tokens.size() && tokens[pos].type != TokenType::EOF_TOKEN) {
+            if (tokens[pos].type == TokenType::START && tokens[pos + 1].type == TokenType::COLON) {
+                depth++;
+            } else if (tokens[pos].type == TokenType::END && tokens[pos + 1].type == TokenType::COLON) {
+                if (--depth == 0) {
+                    return pos;
+                }
+            }
+            pos++;
+        }
+        return SIZE_MAX;
+    }
+    
+    // Scan the cases of a SWITCH body once. The table is only usable when
+    // every CASE ahead of DEFAULT has a literal label; cases after DEFAULT
+    // are never reached, as in the sequential scan.
+    void build_switch_table(SwitchTable& table, size_t body_start) {
+        table.built = true;
+        size_t pos = body_start;
+        
+        while (true) {
+            while (tokens[pos].type == TokenType::NEWLINE) pos++;
+            TokenType type = tokens[pos].type;
+            if (type == TokenType::END) {
+                break;
+            }
+            if (type != TokenType::CASE && type != TokenType::DEFAULT) {
+                return;
+            }
+            
+            const Token* label = nullptr;
+            if (type == TokenType::CASE) {
+                label = &tokens[pos + 1];
+                bool literal = label->type == TokenType::NUMBER || label->type == TokenType::TRUE ||
+                               label->type == TokenType::FALSE || label->type == TokenType::NULL_VALUE ||
+                               (label->type == TokenType::STRING && label->value.compare(0, 10, "\x01TEMPLATE\x01") != 0);
+                if (!literal || tokens[pos + 2].type != TokenType::COLON) {
+                    return;
+                }
+                pos += 3;
+            } else {
+                if (tokens[pos + 1].type != TokenType::COLON) {
+                    return;
+                }
+                pos += 2;
+            }
+            
+            while (tokens[pos].type == TokenType::NEWLINE) pos++;
+            if (tokens[pos].type != TokenType::START || tokens[pos + 1].type != TokenType::COLON) {
+                return;
+            }
+            pos += 2;
+            while (tokens[pos].type == TokenType::NEWLINE) pos++;
+            size_t block_start = pos;
+            size_t block_end = find_block_end(pos);
+            if (block_end == SIZE_MAX) {
+                return;
+            }
+            size_t index = table.blocks.size();
+            table.blocks.push_back({block_start, block_end});
+            pos = block_end + 2;
+            
+            if (type == TokenType::DEFAULT) {
+                table.default_case = index;
+                break;
+            }
+            
+            current = label - tokens.data();
+            ValuePtr value = evaluate_primary();
+            double number = value->to_number();
+            if (value->type == ValueType::STRING) {
+                table.string_labels.emplace(value->string_value, index);
+                if (!std::isnan(number)) {
+                    table.string_label_numbers.emplace(switch_key(number), index);
+                }
+            } else if (!std::isnan(number)) {
+                table.numeric_labels.emplace(switch_key(number), index);
+            }
+        }
+        
+        size_t end_pos = find_block_end(pos);
+        if (end_pos == SIZE_MAX) {
+            return;
+        }
+        table.end_pos = end_pos;
+        table.usable = true;
+    }
+    
+    // First case selected by `value` in a switch table (NO_CASE when none)
+    static size_t lookup_switch_case(const SwitchTable& table, const ValuePtr& value) {
+        size_t found = SwitchTable::NO_CASE;
+        double key = switch_key(value->to_number());
+        
+        auto numeric = table.numeric_labels.find(key);
+        if (numeric != table.numeric_labels.end()) {
+            found = numeric->second;
+        }
+        if (value->type == ValueType::STRING) {
+            auto by_content = table.string_labels.find(value->string_value);
+            if (by_content != table.string_labels.end()) {
+                found = std::min(found, by_content->second);
+            }
+        } else {
+            auto by_number = table.string_label_numbers.find(key);
+            if (by_number != table.string_label_numbers.end()) {
+                found = std::min(found, by_number->second);
+            }
+        }
+        return found;
+    }
+    
     void execute_switch_statement() {
+        Token& switch_token = peek();
         advance(); // Skip 'SWITCH'
         
         ValuePtr switch_value = evaluate_expression();
@@ -2491,6 +4075,36 @@ private:
         advance(); advance(); // Skip START:
         skip_newlines();
         
+        // Jump straight to the selected case when the labels are all literals
+        int slot = site_cache_slot(switch_token, switch_tables);
+        if (slot >= 0) {
+            if (!switch_tables[slot].built) {
+                size_t body_start = current;
+                build_switch_table(switch_tables[slot], body_start);
+                current = body_start;
+            }
+            const SwitchTable& table = switch_tables[slot];
+            if (table.usable) {
+                size_t index = lookup_switch_case(table, switch_value);
+                if (index == SwitchTable::NO_CASE) {
+                    index = table.default_case;
+                }
+                size_t end_pos = table.end_pos;
+                if (index != SwitchTable::NO_CASE) {
+                    current = table.blocks[index].first;
+                    size_t block_end = table.blocks[index].second;
+                    while (current < block_end && !break_flag) {
+                        execute_statement();
+                    }
+                    break_flag = false;
+                }
+                current = end_pos;
+                advance(); advance(); // Skip END:
+                skip_newlines();
+                return;
+            }
+        }
+        
         bool executed = false;
         
         // Parse and execute cases
@@ -2541,7 +4155,7 @@ private:
                 skip_newlines();
                 
                 // Check if this case matches and execute
-                if (!executed && switch_value->to_number() == case_value->to_number()) {
+                if (!executed && switch_matches(switch_value, case_value)) {
                     executed = true;
                     
                     // Execute this case
@@ -2695,7 +4309,7 @@ private:
         skip_newlines();
         
         std::map<std::string, ValuePtr> enum_values;
-        int auto_value = 0;
+        int64_t auto_value = 0;
         
         // Parse enum members
         while (peek().type != TokenType::END && peek().type != TokenType::EOF_TOKEN) {
@@ -2714,9 +4328,9 @@ private:
             if (peek().type == TokenType::ASSIGN) {
                 advance();
                 member_value = evaluate_expression();
-                auto_value = static_cast<int>(member_value->to_number()) + 1;
+                auto_value = member_value->to_int() + 1;
             } else {
-                member_value = Value::make_number(auto_value);
+                member_value = Value::make_int(auto_value);
                 auto_value++;
             }
             
@@ -2844,6 +4458,11 @@ private:
         func.is_generator = false;  // Will be detected at runtime
         func.body_start = body_start;
         func.body_end = body_end;
+        func.min_args = count_required_params(func);
+        auto native_it = native_functions.find({func_name, body_start});
+        if (native_it != native_functions.end()) {
+            func.native = native_it->second;
+        }
         functions[func_name] = func;
     }
     
@@ -2873,6 +4492,9 @@ private:
         // Parse class body (methods)
         Class cls;
         cls.name = class_name;
+        cls.id = next_class_id++;
+        cls.root_shape = std::make_shared<Shape>();
+        cls.root_shape->class_id = cls.id;
         
         while (peek().type != TokenType::END && peek().type != TokenType::EOF_TOKEN) {
             if (peek().type == TokenType::FUNC) {
@@ -2978,8 +4600,11 @@ private:
                 method.params = params;
                 method.default_values = default_values;
                 method.varargs_param = varargs_param;
+                method.is_generator = false;
+                method.is_async = false;
                 method.body_start = body_start;
                 method.body_end = body_end;
+                method.min_args = count_required_params(method);
                 cls.methods[method_name] = method;
             } else {
                 skip_newlines();
@@ -2995,6 +4620,13 @@ private:
         advance(); advance(); // Skip END:
         skip_newlines();
         
+        // Redefining a class invalidates cached method pointers into it
+        if (classes.find(class_name) != classes.end()) {
+            for (auto& cache : method_caches) {
+                cache.count = 0;
+            }
+        }
+        
         // Store class
         classes[class_name] = cls;
     }
@@ -3008,7 +4640,7 @@ private:
         Class& cls = classes[class_name];
         
         // Create instance
-        ValuePtr instance = Value::make_instance(class_name);
+        ValuePtr instance = Value::make_instance(class_name, cls.root_shape);
         
         // Call __init__ if it exists
         if (cls.methods.find("__init__") != cls.methods.end()) {
@@ -3025,111 +4657,143 @@ private:
         return instance;
     }
     
-    // Call a method on an instance
-    ValuePtr call_method(ValuePtr instance, const std::string& method_name, const std::vector<ValuePtr>& args) {
+    // Resolve a method, consulting the call site's inline cache first
+    Function& lookup_method(const ValuePtr& instance, const std::string& method_name, Token* site) {
         if (instance->type != ValueType::INSTANCE) {
             throw_type_error("Cannot call method on non-instance");
         }
         
-        if (classes.find(instance->class_name) == classes.end()) {
-            throw_runtime_error("Class '" + instance->class_name + "' not found");
+        uint32_t class_id = instance->shape->class_id;
+        MethodCache* cache = nullptr;
+        if (site != nullptr) {
+            int slot = site_cache_slot(*site, method_caches);
+            if (slot >= 0) {
+                cache = &method_caches[slot];
+                for (int i = 0; i < cache->count; i++) {
+                    if (cache->class_ids[i] == class_id) {
+                        return *cache->methods[i];
+                    }
+                }
+            }
         }
         
-        Class& cls = classes[instance->class_name];
+        auto cls_it = classes.find(instance->class_name);
+        if (cls_it == classes.end()) {
+            throw_runtime_error("Class '" + instance->class_name + "' not found");
+        }
         
-        if (cls.methods.find(method_name) == cls.methods.end()) {
+        Class& cls = cls_it->second;
+        auto method_it = cls.methods.find(method_name);
+        if (method_it == cls.methods.end()) {
             throw_runtime_error("Method '" + method_name + "' not found in class '" + instance->class_name + "'");
         }
         
-        Function& method = cls.methods[method_name];
-        
-        // Check argument count (first param should be 'self')
-        size_t min_args = 0;
-        for (const auto& param : method.params) {
-            if (method.default_values.find(param) == method.default_values.end()) {
-                min_args++;
-            }
+        // Only cache when the instance belongs to the live definition of its class
+        if (cache != nullptr && cache->count < MethodCache::ENTRIES && cls.id == class_id) {
+            cache->class_ids[cache->count] = class_id;
+            cache->methods[cache->count] = &method_it->second;
+            cache->count++;
         }
         
-        // args already includes self
-        if (args.size() < min_args || (args.size() > method.params.size() && method.varargs_param.empty())) {
+        return method_it->second;
+    }
+    
+    // Call a method on an instance
+    ValuePtr call_method(ValuePtr instance, const std::string& method_name, const std::vector<ValuePtr>& args) {
+        return invoke_method(lookup_method(instance, method_name, nullptr), method_name, args.data(), args.size());
+    }
+    
+    ValuePtr invoke_method(Function& method, const std::string& method_name, const ValuePtr* args, size_t argc) {
+        size_t min_args = method.min_args;
+        
+        // args already includes self (first param should be 'self')
+        if (argc < min_args || (argc > method.params.size() && method.varargs_param.empty())) {
             std::ostringstream oss;
-            oss << "Method '" << method_name << "' expects " << min_args << " argument(s), got " << args.size();
+            oss << "Method '" << method_name << "' expects " << min_args << " argument(s), got " << argc;
             throw_runtime_error(oss.str());
         }
         
-        // Create new environment for method
-        auto method_env = std::make_shared<Environment>(global_env);
-        
-        // Bind parameters (including self)
-        for (size_t i = 0; i < method.params.size(); i++) {
-            if (i < args.size()) {
-                method_env->set(method.params[i], args[i]);
-            } else {
-                // Use default value
-                if (method.default_values.find(method.params[i]) != method.default_values.end()) {
-                    method_env->set(method.params[i], method.default_values[method.params[i]]);
-                }
-            }
-        }
-        
-        // Bind varargs
-        if (!method.varargs_param.empty()) {
-            std::vector<ValuePtr> varargs;
-            for (size_t i = method.params.size(); i < args.size(); i++) {
-                varargs.push_back(args[i]);
-            }
-            method_env->set(method.varargs_param, Value::make_list(varargs));
-        }
+        enter_frame(method_name, method, false);
+        const std::string* class_name =
+            argc > 0 && args[0]->type == ValueType::INSTANCE ? &args[0]->class_name : nullptr;
+        ProfileScope profile_scope(profiler, tracer, Profiler::Kind::METHOD, method_name, class_name);
+        SUSA_STAT("method", class_name != nullptr ? *class_name + "." + method_name : method_name);
+        std::shared_ptr<Environment> method_env = acquire_frame(global_env);
+        call_stack.back().env = method_env.get();
+        bind_arguments(*method_env, method, args, argc);
         
         // Save current state
-        auto saved_env = current_env;
-        auto saved_current = current;
+        std::shared_ptr<Environment> saved_env = std::move(current_env);
+        size_t saved_current = current;
         bool saved_return_flag = return_flag;
-        ValuePtr saved_return_value = return_value;
+        ValuePtr saved_return_value = std::move(return_value);
         
         // Execute method body
         current_env = method_env;
         current = method.body_start;
         return_flag = false;
-        return_value = Value::make_null();
+        return_value = null_value;
         
         while (current < method.body_end && !return_flag) {
             execute_statement();
         }
         
         // Restore state
-        ValuePtr result = return_value;
-        current_env = saved_env;
+        ValuePtr result = std::move(return_value);
+        current_env = std::move(saved_env);
         current = saved_current;
         return_flag = saved_return_flag;
-        return_value = saved_return_value;
+        return_value = std::move(saved_return_value);
+        release_frame(method_env);
+        call_stack.pop_back();
         
         return result;
     }
     
+    // Bind call arguments into a fresh frame by parameter position
+    void bind_arguments(Environment& frame, Function& func, const ValuePtr* args, size_t argc) {
+        for (size_t i = 0; i < func.params.size(); i++) {
+            if (i < argc) {
+                frame.define(func.params[i], args[i]);
+            } else {
+                // Use default value
+                auto default_it = func.default_values.find(func.params[i]);
+                if (default_it == func.default_values.end()) {
+                    throw_runtime_error("Missing required argument: " + func.params[i]);
+                }
+                frame.define(func.params[i], default_it->second);
+            }
+        }
+        
+        // Bind varargs parameter
+        if (!func.varargs_param.empty()) {
+            std::vector<ValuePtr> varargs;
+            for (size_t i = func.params.size(); i < argc; i++) {
+                varargs.push_back(args[i]);
+            }
+            frame.define(func.varargs_param, Value::make_list(varargs));
+        }
+    }
+    
     // Call user-defined function
     ValuePtr call_user_function(const std::string& name, const std::vector<ValuePtr>& args) {
-        if (functions.find(name) == functions.end()) {
+        auto func_it = functions.find(name);
+        if (func_it == functions.end()) {
             throw_runtime_error("Function '" + name + "' not defined");
         }
-        
-        Function& func = functions[name];
-        
+        return call_function(func_it->second, name, args.data(), args.size());
+    }
+    
+    void check_arity(const Function& func, const std::string& name, size_t argc) {
         // Check argument count (with varargs and defaults support)
-        size_t min_args = 0;
-        for (const auto& param : func.params) {
-            if (func.default_values.find(param) == func.default_values.end()) {
-                min_args++;
-            }
-        }
+        size_t min_args = func.min_args;
         
         size_t max_args = func.params.size();
         if (!func.varargs_param.empty()) {
             max_args = SIZE_MAX; // Unlimited with varargs
         }
         
-        if (args.size() < min_args || args.size() > max_args) {
+        if (argc < min_args || argc > max_args) {
             std::ostringstream oss;
             oss << "Function '" << name << "' expects ";
             if (min_args == max_args) {
@@ -3139,55 +4803,147 @@ private:
             } else {
                 oss << min_args << " to " << max_args;
             }
-            oss << " argument(s), got " << args.size();
+            oss << " argument(s), got " << argc;
             throw_runtime_error(oss.str());
         }
+    }
+    
+    // The user function called by `RETURN f(...)` when that call can replace the
+    // current frame: a plain function frame, outside any TRY block it opened,
+    // not yet yielding, with the call making up the whole return expression
+    Function* tail_call_target(const std::string*& name) {
+        if (call_stack.empty() || peek().type != TokenType::IDENTIFIER || peek(1).type != TokenType::LPAREN) {
+            return nullptr;
+        }
+        const CallFrame& frame = call_stack.back();
+        if (!frame.allows_tail_call || frame.try_depth != try_depth || !yielded_values.empty()) {
+            return nullptr;
+        }
         
-        // Create new environment for function
-        auto func_env = std::make_shared<Environment>(global_env);
-        
-        // Bind regular parameters
-        for (size_t i = 0; i < func.params.size(); i++) {
-            if (i < args.size()) {
-                func_env->set(func.params[i], args[i]);
-            } else {
-                // Use default value
-                if (func.default_values.find(func.params[i]) != func.default_values.end()) {
-                    func_env->set(func.params[i], func.default_values[func.params[i]]);
-                } else {
-                    throw_runtime_error("Missing required argument: " + func.params[i]);
-                }
-            }
+        auto func_it = functions.find(peek().value);
+        if (func_it == functions.end() || classes.find(peek().value) != classes.end()) {
+            return nullptr;
+        }
+        ValuePtr shadow = current_env->get(peek().value);
+        if (shadow != nullptr && shadow->type == ValueType::LAMBDA) {
+            return nullptr;
         }
         
-        // Bind varargs parameter
-        if (!func.varargs_param.empty()) {
-            std::vector<ValuePtr> varargs;
-            for (size_t i = func.params.size(); i < args.size(); i++) {
-                varargs.push_back(args[i]);
+        // Find the closing ')' and make sure nothing follows the call
+        size_t pos = current + 2;
+        int depth = 1;
+        while (pos < tokens.size() && tokens[pos].type != TokenType::EOF_TOKEN) {
+            if (tokens[pos].type == TokenType::LPAREN) {
+                depth++;
+            } else if (tokens[pos].type == TokenType::RPAREN && --depth == 0) {
+                break;
             }
-            func_env->set(func.varargs_param, Value::make_list(varargs));
+            pos++;
+        }
+        if (depth != 0 || pos + 1 >= tokens.size()) {
+            return nullptr;
+        }
+        TokenType after = tokens[pos + 1].type;
+        if (after != TokenType::NEWLINE && after != TokenType::END && after != TokenType::EOF_TOKEN) {
+            return nullptr;
         }
         
-        // Save current state
-        auto saved_env = current_env;
-        auto saved_current = current;
+        name = &func_it->first;
+        return &func_it->second;
+    }
+    
+    // Run the C++ lowering of `func` when it has one and nothing needs to
+    // see the call (budgets count calls, profilers and tracers record them).
+    // False when the call is to be interpreted.
+    bool call_native(const Function& func, const ValuePtr* args, size_t argc, ValuePtr& result) {
+        if (func.native == nullptr || budget.instructions > 0 || budget.wall_ms > 0 ||
+            profiler != nullptr || sampler != nullptr || tracer != nullptr || op_stats != nullptr) {
+            return false;
+        }
+        size_t used = native_stack_used();
+        if (call_stack.size() >= max_call_depth || used >= native_stack_limit) {
+            return false;
+        }
+        size_t depth = std::min(max_call_depth - call_stack.size(),
+                                (native_stack_limit - used) / NATIVE_FRAME_BYTES);
+        if (depth == 0 || !func.native(args, argc, depth, result)) {
+            return false;
+        }
+        run_stats.calls++;
+        return true;
+    }
+    
+    ValuePtr call_function(Function& func, const std::string& name, const ValuePtr* args, size_t argc) {
+        check_arity(func, name, argc);
+        ValuePtr native_result;
+        if (call_native(func, args, argc, native_result)) {
+            return native_result;
+        }
+        
+        enter_frame(name, func, true);
+        ProfileScope profile_scope(profiler, tracer, Profiler::Kind::FUNCTION, name);
+        SUSA_STAT("call", name);
+        std::shared_ptr<Environment> func_env = acquire_frame(global_env);
+        call_stack.back().env = func_env.get();
+        bind_arguments(*func_env, func, args, argc);
+        
+        // Save current state (the yield buffer is swapped, not copied)
+        std::shared_ptr<Environment> saved_env = std::move(current_env);
+        size_t saved_current = current;
         bool saved_return_flag = return_flag;
-        ValuePtr saved_return_value = return_value;
+        ValuePtr saved_return_value = std::move(return_value);
         bool saved_yield_flag = yield_flag;
-        std::vector<ValuePtr> saved_yielded_values = yielded_values;
+        std::vector<ValuePtr> saved_yielded_values;
+        saved_yielded_values.swap(yielded_values);
         
         // Execute function body
+        Function* active = &func;
         current_env = func_env;
         current = func.body_start;
         return_flag = false;
-        return_value = Value::make_null();
+        return_value = null_value;
         yield_flag = false;
-        yielded_values.clear();
         
-        while (current < func.body_end && !return_flag) {
-            execute_statement();
-            // Don't stop on yield, continue collecting
+        while (true) {
+            while (current < active->body_end && !return_flag) {
+                execute_statement();
+                // Don't stop on yield, continue collecting
+            }
+            if (tail_call == nullptr) {
+                break;
+            }
+            
+            // Tail call: rebind the frame and run the callee in this loop.
+            // The RETURN that requested it is finished before anything here
+            // can throw, so a TRY around the call sees a clean state.
+            active = tail_call;
+            const std::string& active_name = *tail_call_name;
+            tail_call = nullptr;
+            return_flag = false;
+            return_value = null_value;
+            std::vector<ValuePtr> args;
+            args.swap(tail_args);
+            check_arity(*active, active_name, args.size());
+            ValuePtr native_result;
+            if (call_native(*active, args.data(), args.size(), native_result)) {
+                return_value = std::move(native_result);
+                args.clear();
+                tail_args.swap(args);
+                break;
+            }
+            current_env.reset();
+            release_frame(func_env);
+            func_env = acquire_frame(global_env);
+            bind_arguments(*func_env, *active, args.data(), args.size());
+            args.clear();
+            tail_args.swap(args);  // Keep the buffer for the next tail call
+            call_stack.back() = {&active_name, active, try_depth, true, func_env.get()};
+            profile_scope.replace(Profiler::Kind::FUNCTION, active_name);
+            budget_tick();
+            SUSA_STAT("call", active_name + " (tail)");
+            
+            current_env = func_env;
+            current = active->body_start;
         }
         
         // Check if this was a generator function (had yields)
@@ -3196,16 +4952,18 @@ private:
             // Return a generator object
             result = Value::make_generator(yielded_values);
         } else {
-            result = return_value;
+            result = std::move(return_value);
         }
         
         // Restore state
-        current_env = saved_env;
+        current_env = std::move(saved_env);
         current = saved_current;
         return_flag = saved_return_flag;
-        return_value = saved_return_value;
+        return_value = std::move(saved_return_value);
         yield_flag = saved_yield_flag;
-        yielded_values = saved_yielded_values;
+        yielded_values.swap(saved_yielded_values);
+        release_frame(func_env);
+        call_stack.pop_back();
         
         return result;
     }
@@ -3303,14 +5061,36 @@ private:
         skip_newlines();
         
         // Execute TRY block
+        std::shared_ptr<Environment> try_env = current_env;
+        size_t try_arg_depth = arg_stack.size();
+        size_t try_call_depth = call_stack.size();
+        size_t saved_try_depth = try_depth;
+        bool saved_break_flag = break_flag;
+        bool saved_continue_flag = continue_flag;
+        bool saved_return_flag = return_flag;
         try {
+            try_depth++;
             current = try_start;
             while (current < try_end && !break_flag && !continue_flag && !return_flag) {
                 execute_statement();
             }
+            try_depth = saved_try_depth;
         } catch (const std::exception& e) {
-            // Execute CATCH block
-            current_env->set(error_var, Value::make_string(e.what()));
+            // Unwind frames and arguments left by calls the error escaped from
+            current_env = try_env;
+            arg_stack.resize(try_arg_depth);
+            call_stack.resize(try_call_depth);
+            try_depth = saved_try_depth;
+            tail_call = nullptr;
+            tail_args.clear();
+            break_flag = saved_break_flag;
+            continue_flag = saved_continue_flag;
+            return_flag = saved_return_flag;
+            
+            // Execute CATCH block (further allocations count against the
+            // memory limit again)
+            current_env->set(error_var, Value::make_string(error_message(e)));
+            memory.rearm();
             current = catch_start;
             while (current < catch_end && !break_flag && !continue_flag && !return_flag) {
                 execute_statement();
@@ -3393,31 +5173,229 @@ public:
     Interpreter() : current(0), break_flag(false), continue_flag(false), return_flag(false) {
         global_env = std::make_shared<Environment>();
         current_env = global_env;
-        return_value = Value::make_null();
+        null_value = Value::make_null();
+        return_value = null_value;
+        native_stack_limit = default_native_stack_limit();
+        register_runtime_module();
+    }
+    
+    // Toggle the token optimizer (constant folding, CONST/ENUM inlining)
+    void set_optimize(bool enabled) {
+        optimize = enabled;
+    }
+    
+    // Toggle native compilation of hot numeric loops
+    void set_jit(bool enabled) {
+        jit = enabled;
+    }
+    
+    // Report calls and statements to `active_profiler` (nullptr: off). Calls
+    // removed by inlining and statements run by the loop JIT are not seen,
+    // so profiled runs normally turn both off.
+    void set_profiler(Profiler* active_profiler) {
+        profiler = active_profiler;
+    }
+    
+    // Record call stacks for `active_sampler`'s timer ticks (nullptr: off)
+    void set_sampler(SamplingProfiler* active_sampler) {
+        sampler = active_sampler;
+    }
+    
+    // Count operations into `active_stats` (nullptr: off); only SUSA_STATS
+    // builds count anything (see OpStats::ENABLED)
+    void set_op_stats(OpStats* active_stats) {
+        op_stats = active_stats;
+    }
+    
+    // Record call, import and phase spans into `active_tracer` (nullptr: off)
+    void set_tracer(Tracer* active_tracer) {
+        tracer = active_tracer;
+    }
+    
+    // Toggle inlining of small functions (off keeps every call visible)
+    void set_inline(bool enabled) {
+        inline_limit = enabled ? DEFAULT_INLINE_LIMIT : 0;
+    }
+    
+    // Limit on nested SUSA calls before a RecursionError is raised (tail calls
+    // made with `RETURN f(...)` do not count); by default only the native
+    // stack bounds the depth
+    void set_max_call_depth(size_t depth) {
+        max_call_depth = depth;
+    }
+    
+    // Let the main thread's stack grow to `bytes` (within the hard limit), so
+    // the stack guard of interpreters created afterwards allows deeper
+    // recursion than the usual 8 MB default. Only Linux grows the main stack
+    // past the limit it started with; elsewhere this does nothing.
+    static void raise_stack_limit(size_t bytes = DEEP_STACK_BYTES) {
+#ifdef __linux__
+        struct rlimit limit;
+        if (getrlimit(RLIMIT_STACK, &limit) != 0 || limit.rlim_cur == RLIM_INFINITY ||
+            limit.rlim_cur >= bytes) {
+            return;
+        }
+        limit.rlim_cur = limit.rlim_max == RLIM_INFINITY ? bytes : std::min<rlim_t>(bytes, limit.rlim_max);
+        setrlimit(RLIMIT_STACK, &limit);
+#else
+        (void)bytes;
+#endif
+    }
+
+    // Use `native` for the function `name` whose body starts at token
+    // `body_start` of the program run next (see susa_build.hpp)
+    void register_native(const std::string& name, size_t body_start, NativeFunction native) {
+        native_functions[{name, body_start}] = native;
+    }
+
+    // Instruction, wall time and memory limits for later runs (all off by
+    // default); running out raises a catchable BudgetError
+    void set_budget(const ExecutionBudget& limits) {
+        budget = limits;
+    }
+    
+    // Account for memory even without a limit (ExecutionStats::memory_peak,
+    // runtime.heap_stats()); costs a little on every allocation
+    void set_memory_tracking(bool enabled) {
+        track_memory = enabled;
+    }
+    
+    // Lex and optimize a program: the part of execute() that `susa build`
+    // does ahead of time
+    std::vector<Token> compile(const std::string& source) {
+        std::vector<Token> program;
+        auto phase_start = std::chrono::steady_clock::now();
+        {
+            PhaseScope lex_phase(profiler, tracer, "lex");
+            Lexer lexer(source);
+            program = lexer.tokenize();
+        }
+        run_stats.lex_ms = elapsed_ms(phase_start);
+        if (optimize) {
+            phase_start = std::chrono::steady_clock::now();
+            PhaseScope optimize_phase(profiler, tracer, "optimize");
+            Optimizer optimizer(program, [this](TokenType op, const ValuePtr& left, const ValuePtr& right) {
+                return fold_literal_operation(op, left, right);
+            });
+            optimizer.set_inline_limit(inline_limit);
+            optimizer.run();
+            run_stats.optimize_ms = elapsed_ms(phase_start);
+        }
+        run_stats.tokens = program.size();
+        return program;
     }
     
     std::string execute(const std::string& source) {
+        MemoryAccount::Scope memory_scope(run_account());
+        begin_execution(source);
+        try {
+            tokens = compile(source);
+            run_program();
+        } catch (const std::exception& e) {
+            report_uncaught(e);
+        }
+        finish_execution();
+        return output_buffer.str();
+    }
+    
+    // Run tokens produced by compile(); `source` is only used to show context
+    // in error messages
+    std::string execute_compiled(const std::string& source, std::vector<Token> program) {
+        MemoryAccount::Scope memory_scope(run_account());
+        begin_execution(source);
+        try {
+            tokens = std::move(program);
+            run_program();
+        } catch (const std::exception& e) {
+            report_uncaught(e);
+        }
+        finish_execution();
+        return output_buffer.str();
+    }
+    
+    // Timings and counters of the last execute() / execute_compiled()
+    const ExecutionStats& stats() const {
+        return run_stats;
+    }
+    
+private:
+    static double elapsed_ms(std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    }
+    
+    // This run's account, if it needs one
+    MemoryAccount* run_account() {
+        if (!MemoryAccount::enabled() || (budget.memory_bytes == 0 && !track_memory)) {
+            return nullptr;
+        }
+        return &memory;
+    }
+    
+    void begin_execution(const std::string& source) {
         output_buffer.str("");
         output_buffer.clear();
         source_code = source;
+        run_stats = ExecutionStats();
+        execute_phase_started = false;
+        budget_spent = 0;
+        budget_slice = budget_ticks = 0;
+        memory.rearm();
+        memory.reset_peak();
+        // Diffed in finish_execution()
+        std::copy(std::begin(ValueCounters::created), std::end(ValueCounters::created),
+                  std::begin(run_stats.values_created));
         
         // Initialize error handler with source code
         error_handler = ErrorHandler(source, "", true);
-        
-        try {
-            Lexer lexer(source);
-            tokens = lexer.tokenize();
-            current = 0;
-            
-            while (peek().type != TokenType::EOF_TOKEN) {
-                execute_statement();
-            }
-            
-        } catch (const std::exception& e) {
-            output_buffer << e.what() << "\n";
+    }
+    
+    void finish_execution() {
+        memory.set_limit(0);
+        run_stats.memory_peak = memory.peak();
+        if (execute_phase_started) {
+            run_stats.execute_ms = elapsed_ms(execute_started);
+        }
+        run_stats.instructions = budget_spent + static_cast<uint64_t>(budget_slice - budget_ticks);
+        for (size_t i = 0; i < ValueCounters::TYPE_COUNT; i++) {
+            run_stats.values_created[i] = ValueCounters::created[i] - run_stats.values_created[i];
         }
+        // SUSA_HEAP_DUMP=heap.json: what the finished program still holds
+        if (const char* dump_path = std::getenv("SUSA_HEAP_DUMP")) {
+            write_heap_dump(dump_path);
+        }
+    }
+    
+    // An error no TRY caught ends the run; the limit is lifted first so the
+    // report can't fail
+    void report_uncaught(const std::exception& e) {
+        memory.set_limit(0);
+        output_buffer << error_message(e) << "\n";
+    }
+    
+    void run_program() {
+        PhaseScope execute_phase(profiler, tracer, "execute");
+        execute_started = std::chrono::steady_clock::now();
+        execute_phase_started = true;
+        current = 0;
+        method_caches.clear();
+        property_caches.clear();
+        switch_tables.clear();
+        fused_ops.clear();
+        jit_sites.clear();
+        type_feedback.clear();
+        
+        char stack_marker;
+        native_stack_base = reinterpret_cast<uintptr_t>(&stack_marker);
+        call_stack.clear();
+        arg_stack.clear();
+        try_depth = 0;
+        tail_call = nullptr;
+        check_budget();  // First slice
+        memory.set_limit(MemoryAccount::enabled() ? budget.memory_bytes : 0);
         
-        return output_buffer.str();
+        while (peek().type != TokenType::EOF_TOKEN) {
+            execute_statement();
+        }
     }
 };
 
@@ -0,0 +1,964 @@
+#ifndef SUSA_JIT_HPP
+#define SUSA_JIT_HPP
+
+#include "susa_lexer.hpp"
+#include "susa_value.hpp"
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define SUSA_JIT_X64 1
+#include <sys/mman.h>
+#endif
+
+namespace susa {
+
+// Baseline JIT for hot numeric loops.
+//
+// A WHILE / LOOP WHILE loop whose condition and body only use INT/FLOAT
+// locals, + - * / %, comparisons, AND/OR/NOT, assignments (=, +=, -=, *=,
+// /=, %=, ++, --) and nested IF blocks is compiled to x86-64 code the first
+// time it gets hot. The generated code works on a frame of unboxed slots
+// (int64 or double bits, one per variable) followed by the number of
+// iterations still allowed.
+//
+// Each statement stores its result only after all of its guards passed, so
+// when one fails (int64 overflow, division by zero, an integer modulo by
+// -1) the loop exits with the statement's index and the interpreter finishes
+// the iteration from that statement. Slot types are fixed at compile time;
+// the interpreter checks them on entry and stays interpreted on a mismatch.
+// On other platforms compile_loop() returns nullptr.
+
+enum class JitType : uint8_t {
+    INT,
+    DOUBLE,
+    BOOL  // Only for intermediate results (comparisons, AND/OR/NOT)
+};
+
+struct JitSlot {
+    std::string name;
+    JitType type;
+    bool written;
+    bool redeclared;  // Assigned by a LET, which clears a declared INT/FLOAT type
+};
+
+// Type of a variable at compile time; false for anything but INT/FLOAT values
+using JitTypeOracle = std::function<bool(const std::string&, JitType&)>;
+
+class CompiledLoop {
+public:
+    // Exit codes of run(); values >= 0 are the index of the statement the
+    // interpreter has to resume the current iteration from
+    static constexpr int64_t EXIT_DONE = -1;       // Condition became false
+    static constexpr int64_t EXIT_LIMIT = -2;      // Iteration allowance used up
+    static constexpr int64_t EXIT_CONDITION = -3;  // Guard failed in the condition
+
+    CompiledLoop(std::vector<JitSlot> loop_slots, std::vector<size_t> resume_positions,
+                 void* code, size_t code_size)
+        : slots(std::move(loop_slots)), resume(std::move(resume_positions)),
+          memory(code), memory_size(code_size) {}
+
+    ~CompiledLoop() {
+#ifdef SUSA_JIT_X64
+        munmap(memory, memory_size);
+#endif
+    }
+
+    CompiledLoop(const CompiledLoop&) = delete;
+    CompiledLoop& operator=(const CompiledLoop&) = delete;
+
+    // `frame` holds slots.size() slot values followed by the iteration allowance
+    int64_t run(int64_t* frame) const {
+        using Entry = int64_t (*)(int64_t*);
+        Entry entry;
+        std::memcpy(&entry, &memory, sizeof(entry));
+        return entry(frame);
+    }
+
+    const std::vector<JitSlot>& frame_slots() const { return slots; }
+
+    // Token position of statement `index`
+    size_t resume_position(int64_t index) const { return resume[static_cast<size_t>(index)]; }
+
+private:
+    std::vector<JitSlot> slots;
+    std::vector<size_t> resume;
+    void* memory;
+    size_t memory_size;
+};
+
+#ifdef SUSA_JIT_X64
+
+struct JitExpr {
+    enum Kind { CONSTANT, SLOT, NEGATE, ARITHMETIC, COMPARE, AND, OR, NOT };
+    Kind kind;
+    JitType type;
+    TokenType op = TokenType::PLUS;
+    int64_t int_value = 0;
+    double double_value = 0.0;
+    size_t slot = 0;
+    std::unique_ptr<JitExpr> left;
+    std::unique_ptr<JitExpr> right;
+
+    JitExpr(Kind k, JitType t) : kind(k), type(t) {}
+};
+
+using JitExprPtr = std::unique_ptr<JitExpr>;
+
+struct JitStmt {
+    enum Kind { ASSIGN, IF };
+    Kind kind;
+    size_t index;      // Resume point on a failed guard
+    size_t slot = 0;   // ASSIGN target
+    JitExprPtr value;  // ASSIGN value or IF condition
+    std::vector<JitStmt> body;
+
+    JitStmt(Kind k, size_t i) : kind(k), index(i) {}
+};
+
+// Parses a loop's condition and body tokens into typed expression trees,
+// giving up (nullptr / false) on anything outside the supported subset
+class JitLoopParser {
+public:
+    JitLoopParser(const std::vector<Token>& toks, const JitTypeOracle& type_oracle)
+        : tokens(toks), oracle(type_oracle) {}
+
+    bool parse(size_t condition_start, size_t block_start, size_t block_end) {
+        pos = condition_start;
+        limit = block_end;
+        condition = parse_or();
+        if (condition == nullptr || condition->type != JitType::BOOL ||
+            type_at() != TokenType::COLON) {
+            return false;
+        }
+        pos = block_start;
+        return parse_block(body, block_end);
+    }
+
+    JitExprPtr condition;
+    std::vector<JitStmt> body;
+    std::vector<JitSlot> slots;
+    std::vector<size_t> resume_positions;
+
+private:
+    const std::vector<Token>& tokens;
+    const JitTypeOracle& oracle;
+    std::map<std::string, size_t> slot_index;
+    size_t pos = 0;
+    size_t limit = 0;
+
+    TokenType type_at(size_t offset = 0) const {
+        return pos + offset < limit ? tokens[pos + offset].type : TokenType::EOF_TOKEN;
+    }
+
+    void skip_newlines() {
+        while (type_at() == TokenType::NEWLINE) {
+            pos++;
+        }
+    }
+
+    bool slot_for(const std::string& name, size_t& slot) {
+        auto it = slot_index.find(name);
+        if (it != slot_index.end()) {
+            slot = it->second;
+            return true;
+        }
+        JitType type;
+        if (!oracle(name, type) || type == JitType::BOOL) {
+            return false;
+        }
+        slot = slots.size();
+        slot_index[name] = slot;
+        slots.push_back({name, type, false, false});
+        return true;
+    }
+
+    static bool is_numeric(const JitExprPtr& expr) {
+        return expr != nullptr && expr->type != JitType::BOOL;
+    }
+
+    static JitExprPtr make_node(JitExpr::Kind kind, JitType type, TokenType op,
+                                JitExprPtr left, JitExprPtr right) {
+        JitExprPtr node(new JitExpr(kind, type));
+        node->op = op;
+        node->left = std::move(left);
+        node->right = std::move(right);
+        return node;
+    }
+
+    // Arithmetic with the interpreter's typing: INT op INT stays INT (guarded
+    // against overflow), anything involving a FLOAT is a FLOAT. INT / INT and
+    // FLOAT % FLOAT depend on the operand values and are not compiled.
+    static JitExprPtr make_arithmetic(TokenType op, JitExprPtr left, JitExprPtr right) {
+        if (!is_numeric(left) || !is_numeric(right)) {
+            return nullptr;
+        }
+        bool both_int = left->type == JitType::INT && right->type == JitType::INT;
+        if ((op == TokenType::DIVIDE && both_int) || (op == TokenType::MODULO && !both_int)) {
+            return nullptr;
+        }
+        JitType type = both_int ? JitType::INT : JitType::DOUBLE;
+        return make_node(JitExpr::ARITHMETIC, type, op, std::move(left), std::move(right));
+    }
+
+    JitExprPtr parse_or() {
+        JitExprPtr left = parse_and();
+        while (left != nullptr && type_at() == TokenType::OR) {
+            pos++;
+            JitExprPtr right = parse_and();
+            if (right == nullptr || left->type != JitType::BOOL || right->type != JitType::BOOL) {
+                return nullptr;
+            }
+            left = make_node(JitExpr::OR, JitType::BOOL, TokenType::OR, std::move(left), std::move(right));
+        }
+        return left;
+    }
+
+    JitExprPtr parse_and() {
+        JitExprPtr left = parse_not();
+        while (left != nullptr && type_at() == TokenType::AND) {
+            pos++;
+            JitExprPtr right = parse_not();
+            if (right == nullptr || left->type != JitType::BOOL || right->type != JitType::BOOL) {
+                return nullptr;
+            }
+            left = make_node(JitExpr::AND, JitType::BOOL, TokenType::AND, std::move(left), std::move(right));
+        }
+        return left;
+    }
+
+    JitExprPtr parse_not() {
+        if (type_at() == TokenType::NOT) {
+            pos++;
+            JitExprPtr operand = parse_not();
+            if (operand == nullptr || operand->type != JitType::BOOL) {
+                return nullptr;
+            }
+            return make_node(JitExpr::NOT, JitType::BOOL, TokenType::NOT, std::move(operand), nullptr);
+        }
+        return parse_comparison();
+    }
+
+    JitExprPtr parse_comparison() {
+        JitExprPtr left = parse_addition();
+        while (left != nullptr) {
+            TokenType op = type_at();
+            if (op != TokenType::EQUAL && op != TokenType::NOT_EQUAL &&
+                op != TokenType::LESS && op != TokenType::GREATER &&
+                op != TokenType::LESS_EQUAL && op != TokenType::GREATER_EQUAL) {
+                break;
+            }
+            pos++;
+            JitExprPtr right = parse_addition();
+            if (!is_numeric(left) || !is_numeric(right)) {
+                return nullptr;
+            }
+            left = make_node(JitExpr::COMPARE, JitType::BOOL, op, std::move(left), std::move(right));
+        }
+        return left;
+    }
+
+    JitExprPtr parse_addition() {
+        JitExprPtr left = parse_multiplication();
+        while (left != nullptr && (type_at() == TokenType::PLUS || type_at() == TokenType::MINUS)) {
+            TokenType op = type_at();
+            pos++;
+            left = make_arithmetic(op, std::move(left), parse_multiplication());
+        }
+        return left;
+    }
+
+    JitExprPtr parse_multiplication() {
+        JitExprPtr left = parse_unary();
+        while (left != nullptr && (type_at() == TokenType::MULTIPLY ||
+                                   type_at() == TokenType::DIVIDE ||
+                                   type_at() == TokenType::MODULO)) {
+            TokenType op = type_at();
+            pos++;
+            left = make_arithmetic(op, std::move(left), parse_unary());
+        }
+        return left;
+    }
+
+    JitExprPtr parse_unary() {
+        if (type_at() == TokenType::MINUS) {
+            pos++;
+            JitExprPtr operand = parse_unary();
+            if (!is_numeric(operand)) {
+                return nullptr;
+            }
+            JitType type = operand->type;
+            return make_node(JitExpr::NEGATE, type, TokenType::MINUS, std::move(operand), nullptr);
+        }
+        return parse_primary();
+    }
+
+    JitExprPtr parse_primary() {
+        TokenType type = type_at();
+        if (type == TokenType::NUMBER) {
+            const std::string& text = tokens[pos++].value;
+            int64_t int_value;
+            double double_value;
+            if (parse_integer(text, int_value)) {
+                JitExprPtr node(new JitExpr(JitExpr::CONSTANT, JitType::INT));
+                node->int_value = int_value;
+                return node;
+            }
+            if (!parse_number(text, double_value)) {
+                return nullptr;
+            }
+            JitExprPtr node(new JitExpr(JitExpr::CONSTANT, JitType::DOUBLE));
+            node->double_value = double_value;
+            return node;
+        }
+        if (type == TokenType::IDENTIFIER) {
+            TokenType next = type_at(1);
+            if (next == TokenType::LPAREN || next == TokenType::LBRACKET || next == TokenType::DOT) {
+                return nullptr;
+            }
+            size_t slot;
+            if (!slot_for(tokens[pos++].value, slot)) {
+                return nullptr;
+            }
+            JitExprPtr node(new JitExpr(JitExpr::SLOT, slots[slot].type));
+            node->slot = slot;
+            return node;
+        }
+        if (type == TokenType::LPAREN) {
+            pos++;
+            JitExprPtr inner = parse_or();
+            if (inner == nullptr || type_at() != TokenType::RPAREN) {
+                return nullptr;
+            }
+            pos++;
+            return inner;
+        }
+        return nullptr;
+    }
+
+    size_t add_resume_point(size_t token_pos) {
+        resume_positions.push_back(token_pos);
+        return resume_positions.size() - 1;
+    }
+
+    bool parse_block(std::vector<JitStmt>& out, size_t end) {
+        skip_newlines();
+        while (pos < end) {
+            TokenType type = type_at();
+            if (type == TokenType::IF) {
+                if (!parse_if(out)) return false;
+            } else if (type == TokenType::IDENTIFIER ||
+                       (type == TokenType::LET && type_at(2) == TokenType::ASSIGN)) {
+                if (!parse_assignment(out)) return false;
+            } else {
+                return false;
+            }
+            skip_newlines();
+        }
+        return pos == end;
+    }
+
+    bool parse_if(std::vector<JitStmt>& out) {
+        JitStmt stmt(JitStmt::IF, add_resume_point(pos));
+        pos++;
+        stmt.value = parse_or();
+        if (stmt.value == nullptr || stmt.value->type != JitType::BOOL ||
+            type_at() != TokenType::COLON) {
+            return false;
+        }
+        pos++;
+        skip_newlines();
+        if (type_at() != TokenType::START || type_at(1) != TokenType::COLON) {
+            return false;
+        }
+        pos += 2;
+
+        size_t body_start = pos;
+        int depth = 1;
+        while (pos < limit) {
+            if (type_at() == TokenType::START && type_at(1) == TokenType::COLON) {
+                depth++;
+            } else if (type_at() == TokenType::END && type_at(1) == TokenType::COLON) {
+                if (--depth == 0) break;
+            }
+            pos++;
+        }
+        if (depth != 0) {
+            return false;
+        }
+        size_t body_end = pos;
+        pos = body_start;
+        if (!parse_block(stmt.body, body_end)) {
+            return false;
+        }
+        pos = body_end + 2;  // Skip END:
+        out.push_back(std::move(stmt));
+        return true;
+    }
+
+    // name = / op= / ++ / --, or LET name = (a plain assignment for a
+    // variable without a declared type; see JitSlot::redeclared)
+    bool parse_assignment(std::vector<JitStmt>& out) {
+        size_t start = pos;
+        bool is_let = type_at() == TokenType::LET;
+        if (is_let) {
+            if (type_at(1) != TokenType::IDENTIFIER) {
+                return false;
+            }
+            pos++;
+        }
+        const std::string& name = tokens[pos].value;
+        TokenType op = type_at(1);
+        pos += 2;
+
+        JitExprPtr value;
+        if (op == TokenType::ASSIGN) {
+            value = parse_or();
+        } else if (op == TokenType::INCREMENT || op == TokenType::DECREMENT) {
+            JitExprPtr one(new JitExpr(JitExpr::CONSTANT, JitType::INT));
+            one->int_value = 1;
+            value = make_arithmetic(op == TokenType::INCREMENT ? TokenType::PLUS : TokenType::MINUS,
+                                    parse_variable(name), std::move(one));
+        } else {
+            TokenType arith;
+            switch (op) {
+                case TokenType::PLUS_ASSIGN: arith = TokenType::PLUS; break;
+                case TokenType::MINUS_ASSIGN: arith = TokenType::MINUS; break;
+                case TokenType::MULT_ASSIGN: arith = TokenType::MULTIPLY; break;
+                case TokenType::DIV_ASSIGN: arith = TokenType::DIVIDE; break;
+                case TokenType::MOD_ASSIGN: arith = TokenType::MODULO; break;
+                default: return false;
+            }
+            JitExprPtr right = parse_or();
+            if (right == nullptr) {
+                return false;
+            }
+            value = make_arithmetic(arith, parse_variable(name), std::move(right));
+        }
+
+        size_t slot;
+        if (value == nullptr || (type_at() != TokenType::NEWLINE && pos != limit) ||
+            !slot_for(name, slot) || slots[slot].type != value->type) {
+            return false;
+        }
+        slots[slot].written = true;
+        slots[slot].redeclared |= is_let;
+        JitStmt stmt(JitStmt::ASSIGN, add_resume_point(start));
+        stmt.slot = slot;
+        stmt.value = std::move(value);
+        out.push_back(std::move(stmt));
+        return true;
+    }
+
+    JitExprPtr parse_variable(const std::string& name) {
+        size_t slot;
+        if (!slot_for(name, slot)) {
+            return nullptr;
+        }
+        JitExprPtr node(new JitExpr(JitExpr::SLOT, slots[slot].type));
+        node->slot = slot;
+        return node;
+    }
+};
+
+// Minimal x86-64 encoder for the instructions the loop compiler needs.
+// Memory operands are always [rdi + disp32] (the slot frame).
+class X64Assembler {
+public:
+    enum Reg : uint8_t { RAX = 0, RCX = 1, RDX = 2, RSI = 6, RDI = 7, R8 = 8, R9 = 9, R10 = 10, R11 = 11 };
+    enum Cond : uint8_t {
+        OVERFLOWED = 0x0, BELOW = 0x2, ABOVE_EQUAL = 0x3, EQUAL = 0x4, NOT_EQUAL = 0x5,
+        ABOVE = 0x7, PARITY = 0xA, NO_PARITY = 0xB, LESS = 0xC, GREATER_EQUAL = 0xD,
+        LESS_EQUAL = 0xE, GREATER = 0xF
+    };
+
+    std::vector<uint8_t> code;
+
+    size_t new_label() {
+        labels.push_back(UNBOUND);
+        return labels.size() - 1;
+    }
+
+    void bind(size_t label) { labels[label] = code.size(); }
+
+    void jump(size_t label) {
+        emit(0xE9);
+        fixup(label);
+    }
+
+    void jump_if(Cond cond, size_t label) {
+        emit(0x0F);
+        emit(0x80 | cond);
+        fixup(label);
+    }
+
+    // Patch jump offsets; false if a label was never bound
+    bool finish() {
+        for (const auto& jump : fixups) {
+            if (labels[jump.second] == UNBOUND) {
+                return false;
+            }
+            int32_t offset = static_cast<int32_t>(labels[jump.second]) - static_cast<int32_t>(jump.first + 4);
+            std::memcpy(&code[jump.first], &offset, sizeof(offset));
+        }
+        return true;
+    }
+
+    void load(uint8_t reg, size_t slot) { memory_op(true, {0x8B}, reg, slot); }
+    void store(size_t slot, uint8_t reg) { memory_op(true, {0x89}, reg, slot); }
+    void load_double(uint8_t xmm, size_t slot) { emit(0xF2); memory_op(false, {0x0F, 0x10}, xmm, slot); }
+    void store_double(size_t slot, uint8_t xmm) { emit(0xF2); memory_op(false, {0x0F, 0x11}, xmm, slot); }
+
+    void move_immediate(uint8_t reg, int64_t value) {
+        rex(true, 0, reg);
+        emit(0xB8 | (reg & 7));
+        emit_bytes(&value, sizeof(value));
+    }
+
+    void move(uint8_t dst, uint8_t src) { register_op(0x89, src, dst); }
+    void add(uint8_t dst, uint8_t src) { register_op(0x01, src, dst); }
+    void subtract(uint8_t dst, uint8_t src) { register_op(0x29, src, dst); }
+    void bitwise_and(uint8_t dst, uint8_t src) { register_op(0x21, src, dst); }
+    void bitwise_or(uint8_t dst, uint8_t src) { register_op(0x09, src, dst); }
+    void compare(uint8_t left, uint8_t right) { register_op(0x39, right, left); }
+    void test(uint8_t reg) { register_op(0x85, reg, reg); }
+
+    void multiply(uint8_t dst, uint8_t src) {
+        rex(true, dst, src);
+        emit(0x0F);
+        emit(0xAF);
+        modrm(3, dst, src);
+    }
+
+    void negate(uint8_t reg) { unary_op(0xF7, 3, reg); }
+    void signed_divide(uint8_t reg) { unary_op(0xF7, 7, reg); }
+
+    // sign-extend rax into rdx:rax
+    void cqo() {
+        emit(0x48);
+        emit(0x99);
+    }
+
+    void immediate_op(uint8_t ext, uint8_t reg, int8_t value) {
+        unary_op(0x83, ext, reg);
+        emit(static_cast<uint8_t>(value));
+    }
+    void xor_immediate(uint8_t reg, int8_t value) { immediate_op(6, reg, value); }
+    void subtract_immediate(uint8_t reg, int8_t value) { immediate_op(5, reg, value); }
+    void compare_immediate(uint8_t reg, int8_t value) { immediate_op(7, reg, value); }
+
+    // setcc al / dl, then combine into al
+    void set_al(Cond cond) { emit(0x0F); emit(0x90 | cond); emit(0xC0); }
+    void set_dl(Cond cond) { emit(0x0F); emit(0x90 | cond); emit(0xC2); }
+    void and_al_dl() { emit(0x20); emit(0xD0); }
+    void or_al_dl() { emit(0x08); emit(0xD0); }
+
+    // movzx reg, al
+    void zero_extend_al(uint8_t reg) {
+        rex(true, reg, RAX);
+        emit(0x0F);
+        emit(0xB6);
+        modrm(3, reg, RAX);
+    }
+
+    void add_double(uint8_t dst, uint8_t src) { sse_op(0xF2, 0x58, dst, src); }
+    void multiply_double(uint8_t dst, uint8_t src) { sse_op(0xF2, 0x59, dst, src); }
+    void subtract_double(uint8_t dst, uint8_t src) { sse_op(0xF2, 0x5C, dst, src); }
+    void divide_double(uint8_t dst, uint8_t src) { sse_op(0xF2, 0x5E, dst, src); }
+    void xor_double(uint8_t dst, uint8_t src) { sse_op(0x66, 0x57, dst, src); }
+    // Flags from comparing `left` with `right` (unordered sets ZF, PF and CF)
+    void compare_double(uint8_t left, uint8_t right) { sse_op(0x66, 0x2E, left, right); }
+
+    void int_to_double(uint8_t xmm, uint8_t reg) {
+        emit(0xF2);
+        rex(true, xmm, reg);
+        emit(0x0F);
+        emit(0x2A);
+        modrm(3, xmm, reg);
+    }
+
+    // movq xmm, reg
+    void move_to_double(uint8_t xmm, uint8_t reg) {
+        emit(0x66);
+        rex(true, xmm, reg);
+        emit(0x0F);
+        emit(0x6E);
+        modrm(3, xmm, reg);
+    }
+
+    void return_value(int32_t value) {
+        // mov rax, imm32 (sign-extended); ret
+        emit(0x48);
+        emit(0xC7);
+        emit(0xC0);
+        emit_bytes(&value, sizeof(value));
+        emit(0xC3);
+    }
+
+private:
+    static constexpr size_t UNBOUND = SIZE_MAX;
+    std::vector<size_t> labels;
+    std::vector<std::pair<size_t, size_t>> fixups;  // (offset of rel32, label)
+
+    void emit(uint8_t byte) { code.push_back(byte); }
+
+    void emit_bytes(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        code.insert(code.end(), bytes, bytes + size);
+    }
+
+    void fixup(size_t label) {
+        fixups.push_back({code.size(), label});
+        int32_t placeholder = 0;
+        emit_bytes(&placeholder, sizeof(placeholder));
+    }
+
+    void rex(bool wide, uint8_t reg, uint8_t rm) {
+        uint8_t prefix = 0x40 | (wide ? 0x08 : 0) | ((reg & 8) ? 0x04 : 0) | ((rm & 8) ? 0x01 : 0);
+        if (prefix != 0x40) {
+            emit(prefix);
+        }
+    }
+
+    void modrm(uint8_t mod, uint8_t reg, uint8_t rm) {
+        emit(static_cast<uint8_t>((mod << 6) | ((reg & 7) << 3) | (rm & 7)));
+    }
+
+    void memory_op(bool wide, std::initializer_list<uint8_t> opcode, uint8_t reg, size_t slot) {
+        rex(wide, reg, RDI);
+        for (uint8_t byte : opcode) {
+            emit(byte);
+        }
+        modrm(2, reg, RDI);
+        int32_t displacement = static_cast<int32_t>(slot * sizeof(int64_t));
+        emit_bytes(&displacement, sizeof(displacement));
+    }
+
+    void register_op(uint8_t opcode, uint8_t reg, uint8_t rm) {
+        rex(true, reg, rm);
+        emit(opcode);
+        modrm(3, reg, rm);
+    }
+
+    void unary_op(uint8_t opcode, uint8_t ext, uint8_t reg) {
+        rex(true, 0, reg);
+        emit(opcode);
+        modrm(3, ext, reg);
+    }
+
+    void sse_op(uint8_t prefix, uint8_t opcode, uint8_t dst, uint8_t src) {
+        emit(prefix);
+        rex(false, dst, src);
+        emit(0x0F);
+        emit(opcode);
+        modrm(3, dst, src);
+    }
+};
+
+// Emits the loop: expression temporaries live in a register stack (one GPR
+// and one XMM register per depth), rax/rdx/xmm15 are scratch and rdi points
+// at the frame for the whole run.
+class JitLoopCodegen {
+public:
+    explicit JitLoopCodegen(const JitLoopParser& loop) : parsed(loop) {}
+
+    bool generate() {
+        limit_slot = parsed.slots.size();
+        size_t top = masm.new_label();
+        size_t done = masm.new_label();
+        size_t limit = masm.new_label();
+        size_t condition_failed = masm.new_label();
+        for (size_t i = 0; i < parsed.resume_positions.size(); i++) {
+            resume_labels.push_back(masm.new_label());
+        }
+
+        masm.bind(top);
+        masm.load(X64Assembler::RAX, limit_slot);
+        masm.test(X64Assembler::RAX);
+        masm.jump_if(X64Assembler::EQUAL, limit);
+        if (!expression(*parsed.condition, 0, condition_failed)) {
+            return false;
+        }
+        masm.test(INT_REGS[0]);
+        masm.jump_if(X64Assembler::EQUAL, done);
+        if (!block(parsed.body)) {
+            return false;
+        }
+        masm.load(X64Assembler::RAX, limit_slot);
+        masm.subtract_immediate(X64Assembler::RAX, 1);
+        masm.store(limit_slot, X64Assembler::RAX);
+        masm.jump(top);
+
+        masm.bind(done);
+        masm.return_value(static_cast<int32_t>(CompiledLoop::EXIT_DONE));
+        masm.bind(limit);
+        masm.return_value(static_cast<int32_t>(CompiledLoop::EXIT_LIMIT));
+        masm.bind(condition_failed);
+        masm.return_value(static_cast<int32_t>(CompiledLoop::EXIT_CONDITION));
+        for (size_t i = 0; i < resume_labels.size(); i++) {
+            masm.bind(resume_labels[i]);
+            masm.return_value(static_cast<int32_t>(i));
+        }
+        return masm.finish();
+    }
+
+    const std::vector<uint8_t>& code() const { return masm.code; }
+
+private:
+    static constexpr int MAX_DEPTH = 6;
+    static constexpr uint8_t INT_REGS[MAX_DEPTH] = {
+        X64Assembler::RCX, X64Assembler::RSI, X64Assembler::R8,
+        X64Assembler::R9, X64Assembler::R10, X64Assembler::R11
+    };
+    static constexpr uint8_t XMM_SCRATCH = 15;
+
+    const JitLoopParser& parsed;
+    X64Assembler masm;
+    size_t limit_slot = 0;
+    std::vector<size_t> resume_labels;
+
+    bool block(const std::vector<JitStmt>& stmts) {
+        for (const JitStmt& stmt : stmts) {
+            size_t failed = resume_labels[stmt.index];
+            if (!expression(*stmt.value, 0, failed)) {
+                return false;
+            }
+            if (stmt.kind == JitStmt::IF) {
+                size_t skip = masm.new_label();
+                masm.test(INT_REGS[0]);
+                masm.jump_if(X64Assembler::EQUAL, skip);
+                if (!block(stmt.body)) {
+                    return false;
+                }
+                masm.bind(skip);
+            } else if (stmt.value->type == JitType::INT) {
+                masm.store(stmt.slot, INT_REGS[0]);
+            } else {
+                masm.store_double(stmt.slot, 0);
+            }
+        }
+        return true;
+    }
+
+    void to_double(const JitExpr& expr, int depth) {
+        if (expr.type == JitType::INT) {
+            masm.int_to_double(static_cast<uint8_t>(depth), INT_REGS[depth]);
+        }
+    }
+
+    // Evaluate `expr` into register depth `depth`; guards jump to `failed`
+    bool expression(const JitExpr& expr, int depth, size_t failed) {
+        if (depth >= MAX_DEPTH) {
+            return false;
+        }
+        uint8_t reg = INT_REGS[depth];
+        uint8_t xmm = static_cast<uint8_t>(depth);
+
+        switch (expr.kind) {
+            case JitExpr::CONSTANT:
+                if (expr.type == JitType::INT) {
+                    masm.move_immediate(reg, expr.int_value);
+                } else {
+                    int64_t bits;
+                    std::memcpy(&bits, &expr.double_value, sizeof(bits));
+                    masm.move_immediate(X64Assembler::RAX, bits);
+                    masm.move_to_double(xmm, X64Assembler::RAX);
+                }
+                return true;
+
+            case JitExpr::SLOT:
+                if (expr.type == JitType::INT) {
+                    masm.load(reg, expr.slot);
+                } else {
+                    masm.load_double(xmm, expr.slot);
+                }
+                return true;
+
+            case JitExpr::NEGATE:
+                if (!expression(*expr.left, depth, failed)) {
+                    return false;
+                }
+                if (expr.type == JitType::INT) {
+                    masm.negate(reg);
+                    masm.jump_if(X64Assembler::OVERFLOWED, failed);
+                } else {
+                    masm.move_immediate(X64Assembler::RAX, INT64_MIN);
+                    masm.move_to_double(XMM_SCRATCH, X64Assembler::RAX);
+                    masm.xor_double(xmm, XMM_SCRATCH);
+                }
+                return true;
+
+            case JitExpr::NOT:
+                if (!expression(*expr.left, depth, failed)) {
+                    return false;
+                }
+                masm.xor_immediate(reg, 1);
+                return true;
+
+            default:
+                break;
+        }
+
+        if (!expression(*expr.left, depth, failed) || !expression(*expr.right, depth + 1, failed)) {
+            return false;
+        }
+        uint8_t right_reg = INT_REGS[depth + 1];
+        uint8_t right_xmm = static_cast<uint8_t>(depth + 1);
+
+        if (expr.kind == JitExpr::AND || expr.kind == JitExpr::OR) {
+            if (expr.kind == JitExpr::AND) {
+                masm.bitwise_and(reg, right_reg);
+            } else {
+                masm.bitwise_or(reg, right_reg);
+            }
+            return true;
+        }
+
+        bool int_operands = expr.left->type == JitType::INT && expr.right->type == JitType::INT;
+
+        if (expr.kind == JitExpr::COMPARE) {
+            if (int_operands) {
+                masm.compare(reg, right_reg);
+                masm.set_al(int_condition(expr.op));
+            } else {
+                to_double(*expr.left, depth);
+                to_double(*expr.right, depth + 1);
+                double_comparison(expr.op, xmm, right_xmm);
+            }
+            masm.zero_extend_al(reg);
+            return true;
+        }
+
+        if (int_operands) {
+            switch (expr.op) {
+                case TokenType::PLUS: masm.add(reg, right_reg); break;
+                case TokenType::MINUS: masm.subtract(reg, right_reg); break;
+                case TokenType::MULTIPLY: masm.multiply(reg, right_reg); break;
+                case TokenType::MODULO:
+                    masm.test(right_reg);
+                    masm.jump_if(X64Assembler::EQUAL, failed);
+                    masm.compare_immediate(right_reg, -1);
+                    masm.jump_if(X64Assembler::EQUAL, failed);
+                    masm.move(X64Assembler::RAX, reg);
+                    masm.cqo();
+                    masm.signed_divide(right_reg);
+                    masm.move(reg, X64Assembler::RDX);
+                    return true;
+                default: return false;
+            }
+            masm.jump_if(X64Assembler::OVERFLOWED, failed);
+            return true;
+        }
+
+        to_double(*expr.left, depth);
+        to_double(*expr.right, depth + 1);
+        switch (expr.op) {
+            case TokenType::PLUS: masm.add_double(xmm, right_xmm); break;
+            case TokenType::MINUS: masm.subtract_double(xmm, right_xmm); break;
+            case TokenType::MULTIPLY: masm.multiply_double(xmm, right_xmm); break;
+            case TokenType::DIVIDE:
+                // The interpreter raises ZeroDivisionError; let it
+                masm.xor_double(XMM_SCRATCH, XMM_SCRATCH);
+                masm.compare_double(right_xmm, XMM_SCRATCH);
+                masm.jump_if(X64Assembler::EQUAL, failed);
+                masm.divide_double(xmm, right_xmm);
+                break;
+            default: return false;
+        }
+        return true;
+    }
+
+    static X64Assembler::Cond int_condition(TokenType op) {
+        switch (op) {
+            case TokenType::EQUAL: return X64Assembler::EQUAL;
+            case TokenType::NOT_EQUAL: return X64Assembler::NOT_EQUAL;
+            case TokenType::LESS: return X64Assembler::LESS;
+            case TokenType::LESS_EQUAL: return X64Assembler::LESS_EQUAL;
+            case TokenType::GREATER: return X64Assembler::GREATER;
+            default: return X64Assembler::GREATER_EQUAL;
+        }
+    }
+
+    // Ordered comparisons test "above" with the operands arranged so that an
+    // unordered (NaN) result is false, as with C++ double comparisons
+    void double_comparison(TokenType op, uint8_t left, uint8_t right) {
+        switch (op) {
+            case TokenType::LESS:
+                masm.compare_double(right, left);
+                masm.set_al(X64Assembler::ABOVE);
+                break;
+            case TokenType::LESS_EQUAL:
+                masm.compare_double(right, left);
+                masm.set_al(X64Assembler::ABOVE_EQUAL);
+                break;
+            case TokenType::GREATER:
+                masm.compare_double(left, right);
+                masm.set_al(X64Assembler::ABOVE);
+                break;
+            case TokenType::GREATER_EQUAL:
+                masm.compare_double(left, right);
+                masm.set_al(X64Assembler::ABOVE_EQUAL);
+                break;
+            case TokenType::EQUAL:
+                masm.compare_double(left, right);
+                masm.set_al(X64Assembler::EQUAL);
+                masm.set_dl(X64Assembler::NO_PARITY);
+                masm.and_al_dl();
+                break;
+            default:
+                masm.compare_double(left, right);
+                masm.set_al(X64Assembler::NOT_EQUAL);
+                masm.set_dl(X64Assembler::PARITY);
+                masm.or_al_dl();
+                break;
+        }
+    }
+};
+
+// Compile the loop whose condition starts at `condition_start` and whose body
+// spans [block_start, block_end), or return nullptr when it uses anything the
+// JIT doesn't handle (or executable memory isn't available)
+inline std::unique_ptr<CompiledLoop> compile_loop(const std::vector<Token>& tokens,
+                                                  size_t condition_start, size_t block_start,
+                                                  size_t block_end, const JitTypeOracle& oracle) {
+    JitLoopParser parser(tokens, oracle);
+    if (!parser.parse(condition_start, block_start, block_end)) {
+        return nullptr;
+    }
+    JitLoopCodegen codegen(parser);
+    if (!codegen.generate()) {
+        return nullptr;
+    }
+
+    const std::vector<uint8_t>& code = codegen.code();
+    size_t size = code.size();
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+    std::memcpy(memory, code.data(), size);
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return nullptr;
+    }
+    return std::unique_ptr<CompiledLoop>(
+        new CompiledLoop(std::move(parser.slots), std::move(parser.resume_positions), memory, size));
+}
+
+#else
+
+inline std::unique_ptr<CompiledLoop> compile_loop(const std::vector<Token>&, size_t, size_t,
+                                                  size_t, const JitTypeOracle&) {
+    return nullptr;
+}
+
+#endif  // SUSA_JIT_X64
+
+}  // namespace susa
+
+#endif  // SUSA_JIT_HPP
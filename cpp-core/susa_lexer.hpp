@@ -123,9 +123,10 @@ struct Token {
     std::string value;
     int line;
     int column;
+    int cache_slot;  // Interpreter inline-cache index for the site at this token (-1 = none)
     
     Token(TokenType t, const std::string& v, int l, int c)
-        : type(t), value(v), line(l), column(c) {}
+        : type(t), value(v), line(l), column(c), cache_slot(-1) {}
 };
 
 class Lexer {
@@ -0,0 +1,230 @@
+#ifndef SUSA_MEMORY_HPP
+#define SUSA_MEMORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+// Usable size of a block malloc returned, where the C library can tell
+#if defined(_WIN32)
+#include <malloc.h>
+#define SUSA_BLOCK_SIZE(block) _msize(block)
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define SUSA_BLOCK_SIZE(block) malloc_size(block)
+#elif defined(__linux__)
+#include <malloc.h>
+#define SUSA_BLOCK_SIZE(block) malloc_usable_size(block)
+#endif
+
+namespace susa {
+
+// Thrown by the accounting allocator when an allocation would take an
+// interpreter past its memory limit; reported to SUSA code as a MemoryError
+class MemoryLimitExceeded : public std::bad_alloc {
+public:
+    explicit MemoryLimitExceeded(size_t limit_bytes)
+        : message("Memory limit of " + std::to_string(limit_bytes) + " bytes exceeded") {}
+
+    const char* what() const noexcept override {
+        return message.c_str();
+    }
+
+private:
+    std::string message;
+};
+
+// Per-interpreter memory accounting.
+//
+// A program that defines SUSA_ACCOUNTING_ALLOCATOR before including this
+// header (in one translation unit) replaces the global operator new/delete
+// with malloc/free plus a check for an account installed on the calling
+// thread. When there is one, each allocation is charged to it and each free
+// refunded, by the block's usable size, so no header is needed and blocks
+// can be freed whether or not an account was installed when they were
+// made. An Interpreter installs its own account while it runs only when a
+// memory limit or tracking is asked for; other runs pay one thread-local
+// load per allocation.
+//
+// A block is refunded to whichever account is installed when it is freed,
+// so memory allocated under one account and freed under another (or none)
+// leaves both off by its size. The interpreter keeps its account installed
+// for the whole run, so that only happens to what crosses the run's edges.
+//
+// Once a limit has been hit the account lets allocations through until it
+// is rearmed, so the error can be built and unwound; the interpreter rearms
+// it when a TRY block catches the error.
+class MemoryAccount {
+public:
+    MemoryAccount() = default;
+    MemoryAccount(const MemoryAccount&) = delete;
+    MemoryAccount& operator=(const MemoryAccount&) = delete;
+
+    // Bytes currently allocated through this account
+    size_t used() const {
+        return used_bytes > 0 ? static_cast<size_t>(used_bytes) : 0;
+    }
+
+    // High-water mark of used() since the last reset_peak()
+    size_t peak() const {
+        return peak_bytes;
+    }
+
+    void reset_peak() {
+        peak_bytes = used();
+    }
+
+    // Allocations charged, and their bytes, since the account was created
+    uint64_t allocations() const {
+        return allocation_count;
+    }
+
+    uint64_t allocated() const {
+        return allocated_bytes;
+    }
+
+    // Limit on used() (0: none)
+    void set_limit(size_t bytes) {
+        limit = bytes;
+    }
+
+    void rearm() {
+        tripped = false;
+    }
+
+    // Whether this program replaced operator new with the accounting one
+    // (and the C library reports block sizes)
+    static bool enabled() {
+#ifdef SUSA_BLOCK_SIZE
+        return hooked;
+#else
+        return false;
+#endif
+    }
+
+    // Charges allocations on this thread to `account` for its lifetime; a
+    // null account leaves the one already installed
+    class Scope {
+    public:
+        explicit Scope(MemoryAccount* account) : previous(current) {
+            if (account != nullptr) {
+                current = account;
+            }
+        }
+        ~Scope() {
+            current = previous;
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        MemoryAccount* previous;
+    };
+
+    // operator new / delete of the accounting allocator
+    static void* allocate(size_t size) {
+        void* block = std::malloc(size == 0 ? 1 : size);
+        if (block == nullptr) {
+            throw std::bad_alloc();
+        }
+#ifdef SUSA_BLOCK_SIZE
+        if (MemoryAccount* account = current) {
+            account->charge(block);
+        }
+#endif
+        return block;
+    }
+
+    static void deallocate(void* memory) noexcept {
+#ifdef SUSA_BLOCK_SIZE
+        if (MemoryAccount* account = current) {
+            if (memory != nullptr) {
+                account->refund(SUSA_BLOCK_SIZE(memory));
+            }
+        }
+#endif
+        std::free(memory);
+    }
+
+    static inline bool hooked = false;
+
+private:
+    int64_t used_bytes = 0;  // Signed: refunds may exceed charges (see above)
+    size_t peak_bytes = 0;
+    uint64_t allocation_count = 0;
+    uint64_t allocated_bytes = 0;
+    size_t limit = 0;
+    bool tripped = false;
+
+    static inline thread_local MemoryAccount* current = nullptr;
+
+#ifdef SUSA_BLOCK_SIZE
+    void charge(void* block) {
+        size_t size = SUSA_BLOCK_SIZE(block);
+        used_bytes += static_cast<int64_t>(size);
+        if (limit > 0 && used() > limit && !tripped) {
+            used_bytes -= static_cast<int64_t>(size);
+            std::free(block);
+            tripped = true;
+            throw MemoryLimitExceeded(limit);
+        }
+        allocation_count++;
+        allocated_bytes += size;
+        if (used() > peak_bytes) {
+            peak_bytes = used();
+        }
+    }
+#endif
+
+    void refund(size_t size) {
+        used_bytes -= static_cast<int64_t>(size);
+    }
+};
+
+}  // namespace susa
+
+#ifdef SUSA_ACCOUNTING_ALLOCATOR
+namespace {
+[[maybe_unused]] const bool susa_accounting_hooked = (susa::MemoryAccount::hooked = true);
+}  // namespace
+
+void* operator new(std::size_t size) {
+    return susa::MemoryAccount::allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return susa::MemoryAccount::allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return susa::MemoryAccount::allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* memory) noexcept {
+    susa::MemoryAccount::deallocate(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    susa::MemoryAccount::deallocate(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    susa::MemoryAccount::deallocate(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    susa::MemoryAccount::deallocate(memory);
+}
+#endif  // SUSA_ACCOUNTING_ALLOCATOR
+
+#endif  // SUSA_MEMORY_HPP
@@ -263,11 +263,13 @@ public:
         
         funcs["len"] = [](const std::vector<ValuePtr>& args) {
             if (args[0]->type == ValueType::STRING) {
-                return Value::make_number(args[0]->string_value.length());
+                return Value::make_int(args[0]->string_value.length());
             } else if (args[0]->type == ValueType::LIST) {
-                return Value::make_number(args[0]->list_value.size());
+                return Value::make_int(args[0]->list_value.size());
+            } else if (args[0]->type == ValueType::DICT) {
+                return Value::make_int(args[0]->dict_value.size());
             }
-            return Value::make_number(0);
+            return Value::make_int(0);
         };
         
         funcs["upper"] = [](const std::vector<ValuePtr>& args) {
@@ -989,10 +991,8 @@ public:
                     return "null";
                 } else if (val->type == ValueType::BOOLEAN) {
                     return val->bool_value ? "true" : "false";
-                } else if (val->type == ValueType::NUMBER) {
-                    std::ostringstream oss;
-                    oss << val->number_value;
-                    return oss.str();
+                } else if (val->is_numeric()) {
+                    return val->to_string();
                 } else if (val->type == ValueType::STRING) {
                     return "\"" + val->string_value + "\"";
                 } else if (val->type == ValueType::LIST) {
@@ -1022,10 +1022,8 @@ public:
                     return "null";
                 } else if (val->type == ValueType::BOOLEAN) {
                     return val->bool_value ? "true" : "false";
-                } else if (val->type == ValueType::NUMBER) {
-                    std::ostringstream oss;
-                    oss << val->number_value;
-                    return oss.str();
+                } else if (val->is_numeric()) {
+                    return val->to_string();
                 } else if (val->type == ValueType::STRING) {
                     return "\"" + val->string_value + "\"";
                 } else if (val->type == ValueType::LIST) {
@@ -1058,7 +1056,7 @@ public:
         };
         
         funcs["is_number"] = [](const std::vector<ValuePtr>& args) {
-            return Value::make_bool(args[0]->type == ValueType::NUMBER);
+            return Value::make_bool(args[0]->is_numeric());
         };
         
         funcs["is_boolean"] = [](const std::vector<ValuePtr>& args) {
@@ -1739,6 +1737,12 @@ public:
         return Value::make_null();
     }
     
+    // Add a function to a module; modules whose functions need interpreter
+    // state (runtime) are filled in by the interpreter
+    void register_function(const std::string& module_name, const std::string& func_name, BuiltinFunction func) {
+        modules[module_name][func_name] = std::move(func);
+    }
+    
     // Check if module exists
     bool has_module(const std::string& module_name) {
         return modules.find(module_name) != modules.end();
@@ -0,0 +1,136 @@
+#ifndef SUSA_NATIVE_HPP
+#define SUSA_NATIVE_HPP
+
+#include "susa_value.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace susa {
+
+// Runtime support for functions `susa build` lowers to C++.
+//
+// Lowered functions compute on NativeNumbers, which follow the interpreter's
+// numeric rules: two INTEGER operands stay exact in int64 and promote to
+// double only on overflow or an inexact quotient, anything else is a double.
+// An operation that would raise in the interpreter (division or modulo by
+// zero) clears `ok` instead. The lowered function then gives up and the
+// interpreter runs the whole call, raising the error as usual; lowered
+// functions are pure, so starting the call over is safe.
+
+// Entry point of a lowered function: the call's arguments and the number of
+// nested calls it may still make (call depth and native stack permitting).
+// False hands the call to the interpreter.
+using NativeFunction = bool (*)(const ValuePtr* args, size_t argc, size_t depth, ValuePtr& result);
+
+struct NativeNumber {
+    bool is_int = true;
+    int64_t i = 0;
+    double d = 0.0;
+
+    static NativeNumber of(int64_t value) {
+        NativeNumber number;
+        number.i = value;
+        return number;
+    }
+
+    static NativeNumber of(double value) {
+        NativeNumber number;
+        number.is_int = false;
+        number.d = value;
+        return number;
+    }
+
+    double to_double() const {
+        return is_int ? static_cast<double>(i) : d;
+    }
+
+    // INTEGER and NUMBER values convert; false for anything else
+    static bool from_value(const ValuePtr& value, NativeNumber& out) {
+        if (value->type == ValueType::INTEGER) {
+            out = of(value->int_value);
+            return true;
+        }
+        if (value->type == ValueType::NUMBER) {
+            out = of(value->number_value);
+            return true;
+        }
+        return false;
+    }
+
+    ValuePtr to_value() const {
+        return is_int ? Value::make_int(i) : Value::make_number(d);
+    }
+
+    static NativeNumber add(NativeNumber a, NativeNumber b) {
+        int64_t result;
+        if (a.is_int && b.is_int && checked_add(a.i, b.i, result)) return of(result);
+        return of(a.to_double() + b.to_double());
+    }
+
+    static NativeNumber subtract(NativeNumber a, NativeNumber b) {
+        int64_t result;
+        if (a.is_int && b.is_int && checked_sub(a.i, b.i, result)) return of(result);
+        return of(a.to_double() - b.to_double());
+    }
+
+    static NativeNumber multiply(NativeNumber a, NativeNumber b) {
+        int64_t result;
+        if (a.is_int && b.is_int && checked_mul(a.i, b.i, result)) return of(result);
+        return of(a.to_double() * b.to_double());
+    }
+
+    static NativeNumber divide(NativeNumber a, NativeNumber b, bool& ok) {
+        if (b.is_int ? b.i == 0 : b.d == 0) {
+            ok = false;
+            return NativeNumber();
+        }
+        if (a.is_int && b.is_int && b.i != -1 && a.i % b.i == 0) return of(a.i / b.i);
+        return of(a.to_double() / b.to_double());
+    }
+
+    static NativeNumber modulo(NativeNumber a, NativeNumber b, bool& ok) {
+        if (b.is_int ? b.i == 0 : b.d == 0) {
+            ok = false;
+            return NativeNumber();
+        }
+        if (a.is_int && b.is_int) return of(b.i == -1 ? int64_t(0) : a.i % b.i);
+        return of(std::fmod(a.to_double(), b.to_double()));
+    }
+
+    static NativeNumber power(NativeNumber a, NativeNumber b) {
+        if (a.is_int && b.is_int && b.i >= 0) {
+            int64_t base = a.i;
+            int64_t acc = 1;
+            bool exact = true;
+            for (int64_t e = b.i; e > 0 && exact; e >>= 1) {
+                if (e & 1) exact = checked_mul(acc, base, acc);
+                if (exact && e > 1) exact = checked_mul(base, base, base);
+            }
+            if (exact) return of(acc);
+        }
+        return of(std::pow(a.to_double(), b.to_double()));
+    }
+
+    static NativeNumber negate(NativeNumber a) {
+        if (a.is_int && a.i != std::numeric_limits<int64_t>::min()) return of(-a.i);
+        return of(-a.to_double());
+    }
+
+    // Ordering and equality with `compare` (std::less<>() and so on);
+    // INTEGER pairs compare exactly
+    template <typename Compare>
+    static bool compare(NativeNumber a, NativeNumber b, Compare compare) {
+        if (a.is_int && b.is_int) return compare(a.i, b.i);
+        return compare(a.to_double(), b.to_double());
+    }
+
+    // AND / OR evaluate both operands, as the interpreter does
+    static bool both(bool a, bool b) { return a && b; }
+    static bool either(bool a, bool b) { return a || b; }
+};
+
+}  // namespace susa
+
+#endif  // SUSA_NATIVE_HPP
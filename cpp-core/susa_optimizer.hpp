@@ -0,0 +1,894 @@
+#ifndef SUSA_OPTIMIZER_HPP
+#define SUSA_OPTIMIZER_HPP
+
+#include "susa_lexer.hpp"
+#include "susa_value.hpp"
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace susa {
+
+// Token-level optimizer, run once over a program before it executes.
+// It folds literal subexpressions, inlines top-level CONST and ENUM values at
+// their read sites, drops IF blocks whose condition is a false literal and
+// inlines small single-expression functions at their call sites.
+// Rewritten tokens keep the line/column of the source they replace.
+class Optimizer {
+public:
+    // Evaluates `left op right` for two literal operands, or returns nullptr
+    // when the operation has to be left to runtime (errors, unsupported ops)
+    using BinaryFolder = std::function<ValuePtr(TokenType, const ValuePtr&, const ValuePtr&)>;
+
+    Optimizer(std::vector<Token>& toks, BinaryFolder folder)
+        : tokens(toks), fold_binary(std::move(folder)) {}
+
+    // Inline functions whose returned expression has at most `max_tokens`
+    // tokens (0 disables function inlining)
+    void set_inline_limit(size_t max_tokens) {
+        inline_limit = max_tokens;
+    }
+
+    void run() {
+        fold_constants();
+        // A CONST may be defined in terms of earlier ones
+        for (int round = 0; round < 4 && inline_constants(); round++) {
+            fold_constants();
+        }
+        remove_dead_branches();
+        if (inline_limit > 0 && inline_functions()) {
+            fold_constants();
+        }
+    }
+
+private:
+    std::vector<Token>& tokens;
+    BinaryFolder fold_binary;
+    size_t inline_limit = 0;
+
+    struct ConstDef {
+        size_t defined_at;  // Index of the defining statement
+        Token literal;
+    };
+
+    struct EnumDef {
+        size_t defined_at;  // Index just past the ENUM block
+        std::map<std::string, Token> members;
+    };
+
+    // ===== Token classification =====
+
+    static int binary_precedence(TokenType type) {
+        switch (type) {
+            case TokenType::OR: return 1;
+            case TokenType::AND: return 2;
+            case TokenType::EQUAL: case TokenType::NOT_EQUAL:
+            case TokenType::LESS: case TokenType::GREATER:
+            case TokenType::LESS_EQUAL: case TokenType::GREATER_EQUAL: return 4;
+            case TokenType::BIT_OR: return 5;
+            case TokenType::BIT_XOR: return 6;
+            case TokenType::BIT_AND: return 7;
+            case TokenType::LEFT_SHIFT: case TokenType::RIGHT_SHIFT: return 8;
+            case TokenType::PLUS: case TokenType::MINUS: return 9;
+            case TokenType::MULTIPLY: case TokenType::DIVIDE: case TokenType::MODULO: return 10;
+            case TokenType::POWER: return 11;
+            default: return 0;
+        }
+    }
+
+    static const int NOT_PRECEDENCE = 3;
+
+    static bool ends_operand(TokenType type) {
+        return type == TokenType::NUMBER || type == TokenType::STRING ||
+               type == TokenType::IDENTIFIER || type == TokenType::RPAREN ||
+               type == TokenType::RBRACKET || type == TokenType::RBRACE ||
+               type == TokenType::TRUE || type == TokenType::FALSE ||
+               type == TokenType::NULL_VALUE;
+    }
+
+    // Tokens after which '(' can only start a parenthesized expression
+    static bool opens_expression(TokenType type) {
+        switch (type) {
+            case TokenType::LPAREN: case TokenType::LBRACKET: case TokenType::LBRACE:
+            case TokenType::COMMA: case TokenType::COLON: case TokenType::NEWLINE:
+            case TokenType::NOT: case TokenType::BIT_NOT: case TokenType::RETURN:
+            case TokenType::IF: case TokenType::WHILE:
+                return true;
+            default:
+                return binary_precedence(type) > 0 || is_assignment(type);
+        }
+    }
+
+    static bool is_template(const Token& token) {
+        return token.value.compare(0, 10, "\x01TEMPLATE\x01") == 0;
+    }
+
+    static bool is_literal(const Token& token) {
+        switch (token.type) {
+            case TokenType::NUMBER:
+            case TokenType::TRUE:
+            case TokenType::FALSE:
+            case TokenType::NULL_VALUE:
+                return true;
+            case TokenType::STRING:
+                return !is_template(token);
+            default:
+                return false;
+        }
+    }
+
+    static bool is_assignment(TokenType type) {
+        return type == TokenType::ASSIGN || type == TokenType::PLUS_ASSIGN ||
+               type == TokenType::MINUS_ASSIGN || type == TokenType::MULT_ASSIGN ||
+               type == TokenType::DIV_ASSIGN || type == TokenType::MOD_ASSIGN ||
+               type == TokenType::POW_ASSIGN || type == TokenType::INCREMENT ||
+               type == TokenType::DECREMENT;
+    }
+
+    // Keywords after which an identifier is being bound, not read
+    static bool is_binding_keyword(TokenType type) {
+        switch (type) {
+            case TokenType::LET: case TokenType::CONST_VAR: case TokenType::STATIC:
+            case TokenType::INT: case TokenType::STRING_TYPE: case TokenType::BOOL:
+            case TokenType::FLOAT: case TokenType::DOUBLE: case TokenType::CHAR:
+            case TokenType::FOR: case TokenType::CATCH: case TokenType::AS:
+            case TokenType::FUNC: case TokenType::CLASS: case TokenType::ENUM:
+            case TokenType::ADD: case TokenType::USE: case TokenType::FROM:
+            case TokenType::SHARE: case TokenType::INCREMENT: case TokenType::DECREMENT:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool is_block_start(size_t i) const {
+        return i + 1 < tokens.size() && tokens[i].type == TokenType::START &&
+               tokens[i + 1].type == TokenType::COLON;
+    }
+
+    bool is_block_end(size_t i) const {
+        return i + 1 < tokens.size() && tokens[i].type == TokenType::END &&
+               tokens[i + 1].type == TokenType::COLON;
+    }
+
+    bool is_statement_start(size_t i) const {
+        return i == 0 || tokens[i - 1].type == TokenType::NEWLINE ||
+               tokens[i - 1].type == TokenType::COLON;
+    }
+
+    // Index of the END of the block opened at `start` (a START token)
+    size_t find_block_end(size_t start) const {
+        int depth = 0;
+        for (size_t i = start; i < tokens.size(); i++) {
+            if (is_block_start(i)) {
+                depth++;
+            } else if (is_block_end(i) && --depth == 0) {
+                return i;
+            }
+        }
+        return tokens.size();
+    }
+
+    // ===== Literal conversion =====
+
+    static ValuePtr literal_value(const Token& token) {
+        switch (token.type) {
+            case TokenType::NUMBER: {
+                int64_t int_value;
+                if (parse_integer(token.value, int_value)) {
+                    return Value::make_int(int_value);
+                }
+                double number;
+                if (parse_number(token.value, number)) {
+                    return Value::make_number(number);
+                }
+                return nullptr;
+            }
+            case TokenType::TRUE: return Value::make_bool(true);
+            case TokenType::FALSE: return Value::make_bool(false);
+            case TokenType::NULL_VALUE: return Value::make_null();
+            case TokenType::STRING: return Value::make_string(token.value);
+            default: return nullptr;
+        }
+    }
+
+    // Literal token for a folded value, positioned at `at`. Doubles keep a
+    // decimal point so they are read back as NUMBER rather than INTEGER.
+    static bool make_literal(const ValuePtr& value, const Token& at, Token& out) {
+        switch (value->type) {
+            case ValueType::INTEGER: {
+                std::string text;
+                append_integer(text, value->int_value);
+                out = Token(TokenType::NUMBER, text, at.line, at.column);
+                return true;
+            }
+            case ValueType::NUMBER: {
+                if (!std::isfinite(value->number_value)) {
+                    return false;
+                }
+                std::string text;
+                append_number(text, value->number_value);
+                int64_t integral;
+                if (parse_integer(text, integral)) {
+                    text += ".0";
+                }
+                double round_trip;
+                if (!parse_number(text, round_trip) || round_trip != value->number_value) {
+                    return false;
+                }
+                out = Token(TokenType::NUMBER, text, at.line, at.column);
+                return true;
+            }
+            case ValueType::BOOLEAN:
+                out = value->bool_value ? Token(TokenType::TRUE, "true", at.line, at.column)
+                                        : Token(TokenType::FALSE, "false", at.line, at.column);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // ===== Constant folding =====
+
+    // Fold prefix operators applied to a literal on top of `out`
+    bool fold_unary(std::vector<Token>& out, TokenType next) {
+        size_t n = out.size();
+        TokenType op = out[n - 2].type;
+        if (n >= 3 && ends_operand(out[n - 3].type)) {
+            return false;  // Binary operator, not a prefix
+        }
+
+        ValuePtr operand = literal_value(out[n - 1]);
+        if (operand == nullptr) {
+            return false;
+        }
+
+        ValuePtr result;
+        if (op == TokenType::MINUS && out[n - 1].type == TokenType::NUMBER) {
+            if (operand->type == ValueType::INTEGER &&
+                operand->int_value != std::numeric_limits<int64_t>::min()) {
+                result = Value::make_int(-operand->int_value);
+            } else {
+                result = Value::make_number(-operand->to_number());
+            }
+        } else if (op == TokenType::BIT_NOT && out[n - 1].type == TokenType::NUMBER) {
+            result = Value::make_int(~operand->to_int());
+        } else if (op == TokenType::NOT && out[n - 1].type != TokenType::STRING &&
+                   binary_precedence(next) < NOT_PRECEDENCE) {
+            // NOT takes a whole comparison, so only fold when nothing binds tighter
+            result = Value::make_bool(!operand->is_truthy());
+        } else {
+            return false;
+        }
+
+        Token literal = out[n - 1];
+        if (!make_literal(result, out[n - 2], literal)) {
+            return false;
+        }
+        out.pop_back();
+        out.back() = literal;
+        return true;
+    }
+
+    // Fold `literal op literal` on top of `out` when precedence on both sides
+    // makes it a complete subexpression
+    bool fold_binary_top(std::vector<Token>& out, TokenType next) {
+        size_t n = out.size();
+        const Token& left = out[n - 3];
+        TokenType op = out[n - 2].type;
+        const Token& right = out[n - 1];
+        int precedence = binary_precedence(op);
+        if (precedence <= 2 || left.type != TokenType::NUMBER || right.type != TokenType::NUMBER) {
+            return false;
+        }
+
+        if (n >= 4) {
+            TokenType before = out[n - 4].type;
+            int before_precedence = binary_precedence(before);
+            bool prefix = n < 5 || !ends_operand(out[n - 5].type);
+            if (before_precedence > 0 && prefix) {
+                return false;  // Unary minus binds tighter than any binary operator
+            }
+            if (before == TokenType::BIT_NOT) {
+                return false;
+            }
+            bool right_assoc_chain = op == TokenType::POWER && before == TokenType::POWER;
+            if (before_precedence >= precedence && !right_assoc_chain) {
+                return false;
+            }
+        }
+
+        int next_precedence = binary_precedence(next);
+        if (next_precedence > precedence || (next_precedence == precedence && op == TokenType::POWER)) {
+            return false;
+        }
+        if (next == TokenType::LBRACKET || next == TokenType::DOT || next == TokenType::LPAREN) {
+            return false;
+        }
+
+        ValuePtr left_value = literal_value(left);
+        ValuePtr right_value = literal_value(right);
+        if (left_value == nullptr || right_value == nullptr) {
+            return false;
+        }
+        ValuePtr result = fold_binary(op, left_value, right_value);
+        if (result == nullptr) {
+            return false;
+        }
+
+        Token literal = left;
+        if (!make_literal(result, left, literal)) {
+            return false;
+        }
+        out.erase(out.end() - 3, out.end());
+        out.push_back(literal);
+        return true;
+    }
+
+    void reduce(std::vector<Token>& out, TokenType next) {
+        while (!out.empty() && is_literal(out.back())) {
+            size_t n = out.size();
+            if (n >= 2 && (out[n - 2].type == TokenType::MINUS || out[n - 2].type == TokenType::BIT_NOT ||
+                           out[n - 2].type == TokenType::NOT) && fold_unary(out, next)) {
+                continue;
+            }
+            if (n >= 3 && fold_binary_top(out, next)) {
+                continue;
+            }
+            return;
+        }
+    }
+
+    bool fold_constants() {
+        std::vector<Token> out;
+        out.reserve(tokens.size());
+        size_t original_size = tokens.size();
+
+        for (size_t i = 0; i < tokens.size(); i++) {
+            const Token& token = tokens[i];
+            TokenType next = i + 1 < tokens.size() ? tokens[i + 1].type : TokenType::EOF_TOKEN;
+
+            // (literal) -> literal where the parentheses only group (calls such
+            // as int(5) or obj.add(1) use keyword names, so check what precedes)
+            size_t n = out.size();
+            if (token.type == TokenType::RPAREN && n >= 2 && is_literal(out[n - 1]) &&
+                out[n - 2].type == TokenType::LPAREN && (n < 3 || opens_expression(out[n - 3].type))) {
+                Token literal = out[n - 1];
+                out.pop_back();
+                out.back() = literal;
+                reduce(out, next);
+                continue;
+            }
+
+            out.push_back(token);
+            reduce(out, next);
+        }
+
+        tokens.swap(out);
+        return tokens.size() != original_size;
+    }
+
+    // ===== CONST / ENUM inlining =====
+
+    // Names that are bound anywhere other than their CONST definition
+    std::set<std::string> collect_rebound_names() const {
+        std::set<std::string> rebound;
+        bool in_header = false;  // FUNC/LAMBDA parameter lists
+
+        for (size_t i = 0; i < tokens.size(); i++) {
+            const Token& token = tokens[i];
+            if (token.type == TokenType::FUNC || token.type == TokenType::LAMBDA) {
+                in_header = true;
+            } else if (in_header && (token.type == TokenType::COLON || token.type == TokenType::NEWLINE)) {
+                in_header = false;
+            }
+            if (token.type != TokenType::IDENTIFIER) {
+                // Destructuring: LET [a, b] = ...
+                if (is_binding_keyword(token.type) && i + 1 < tokens.size() &&
+                    tokens[i + 1].type == TokenType::LBRACKET) {
+                    for (size_t j = i + 2; j < tokens.size() && tokens[j].type != TokenType::RBRACKET; j++) {
+                        if (tokens[j].type == TokenType::IDENTIFIER) {
+                            rebound.insert(tokens[j].value);
+                        }
+                    }
+                }
+                continue;
+            }
+
+            // CONST definitions are vetted by inline_constants; FUNC names are
+            // not variables
+            TokenType next = i + 1 < tokens.size() ? tokens[i + 1].type : TokenType::EOF_TOKEN;
+            TokenType prev = i > 0 ? tokens[i - 1].type : TokenType::NEWLINE;
+            if (prev == TokenType::CONST_VAR || prev == TokenType::FUNC) {
+                continue;
+            }
+            bool bound = in_header || is_assignment(next) || is_binding_keyword(prev);
+
+            // Multiple assignment: a, b = ...
+            if (!bound && next == TokenType::COMMA && is_statement_start(i)) {
+                size_t j = i;
+                while (j + 2 < tokens.size() && tokens[j + 1].type == TokenType::COMMA &&
+                       tokens[j + 2].type == TokenType::IDENTIFIER) {
+                    j += 2;
+                }
+                if (j + 1 < tokens.size() && tokens[j + 1].type == TokenType::ASSIGN) {
+                    for (size_t k = i; k <= j; k += 2) {
+                        rebound.insert(tokens[k].value);
+                    }
+                }
+            }
+
+            if (bound) {
+                rebound.insert(token.value);
+            }
+        }
+        return rebound;
+    }
+
+    bool inline_constants() {
+        std::map<std::string, ConstDef> consts;
+        std::map<std::string, EnumDef> enum_defs;
+        std::set<std::string> excluded;
+
+        // Definitions at the top level are straight-line code, so every later
+        // token only runs once they exist
+        int depth = 0;
+        for (size_t i = 0; i < tokens.size(); i++) {
+            if (is_block_start(i)) {
+                depth++;
+                i++;
+                continue;
+            }
+            if (is_block_end(i)) {
+                depth--;
+                i++;
+                continue;
+            }
+
+            if (tokens[i].type == TokenType::CONST_VAR && i + 3 < tokens.size() &&
+                tokens[i + 1].type == TokenType::IDENTIFIER && tokens[i + 2].type == TokenType::ASSIGN) {
+                const std::string& name = tokens[i + 1].value;
+                bool simple = depth == 0 && is_statement_start(i) && is_literal(tokens[i + 3]) &&
+                              (i + 4 >= tokens.size() || tokens[i + 4].type == TokenType::NEWLINE ||
+                               tokens[i + 4].type == TokenType::EOF_TOKEN);
+                if (!simple || consts.count(name)) {
+                    excluded.insert(name);
+                } else {
+                    consts.emplace(name, ConstDef{i + 4, tokens[i + 3]});
+                }
+            }
+
+            if (tokens[i].type == TokenType::ENUM && i + 1 < tokens.size() &&
+                tokens[i + 1].type == TokenType::IDENTIFIER) {
+                const std::string& name = tokens[i + 1].value;
+                EnumDef def;
+                if (depth != 0 || !is_statement_start(i) || enum_defs.count(name) || !parse_enum(i, def)) {
+                    excluded.insert(name);
+                } else {
+                    enum_defs[name] = def;
+                }
+            }
+        }
+
+        std::set<std::string> rebound = collect_rebound_names();
+        for (const auto& name : excluded) {
+            consts.erase(name);
+            enum_defs.erase(name);
+        }
+        for (auto it = consts.begin(); it != consts.end();) {
+            if (rebound.count(it->first) || enum_defs.count(it->first)) {
+                it = consts.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (consts.empty() && enum_defs.empty()) {
+            return false;
+        }
+
+        std::vector<Token> out;
+        out.reserve(tokens.size());
+        bool changed = false;
+        for (size_t i = 0; i < tokens.size(); i++) {
+            const Token& token = tokens[i];
+            if (token.type != TokenType::IDENTIFIER || (i > 0 && tokens[i - 1].type == TokenType::DOT)) {
+                out.push_back(token);
+                continue;
+            }
+            TokenType next = i + 1 < tokens.size() ? tokens[i + 1].type : TokenType::EOF_TOKEN;
+
+            // Enum member: Name.MEMBER
+            auto enum_it = enum_defs.find(token.value);
+            if (enum_it != enum_defs.end() && next == TokenType::DOT && i >= enum_it->second.defined_at &&
+                i + 2 < tokens.size() && tokens[i + 2].type == TokenType::IDENTIFIER) {
+                TokenType after = i + 3 < tokens.size() ? tokens[i + 3].type : TokenType::EOF_TOKEN;
+                auto member = enum_it->second.members.find(tokens[i + 2].value);
+                if (member != enum_it->second.members.end() && !is_assignment(after) &&
+                    after != TokenType::LPAREN && after != TokenType::DOT && after != TokenType::LBRACKET) {
+                    Token literal = member->second;
+                    literal.line = token.line;
+                    literal.column = token.column;
+                    out.push_back(literal);
+                    i += 2;
+                    changed = true;
+                    continue;
+                }
+            }
+
+            // CONST read
+            auto const_it = consts.find(token.value);
+            if (const_it != consts.end() && i >= const_it->second.defined_at &&
+                next != TokenType::LPAREN && next != TokenType::DOT && next != TokenType::LBRACKET) {
+                Token literal = const_it->second.literal;
+                literal.line = token.line;
+                literal.column = token.column;
+                out.push_back(literal);
+                changed = true;
+                continue;
+            }
+
+            out.push_back(token);
+        }
+
+        tokens.swap(out);
+        return changed;
+    }
+
+    // Member values of `ENUM Name: START: A, B = 5, ... END:` when every
+    // explicit value is a number literal (mirrors execute_enum_statement)
+    bool parse_enum(size_t pos, EnumDef& def) const {
+        size_t i = pos + 2;
+        if (i + 2 >= tokens.size() || tokens[i].type != TokenType::COLON) {
+            return false;
+        }
+        i++;
+        while (i < tokens.size() && tokens[i].type == TokenType::NEWLINE) i++;
+        if (!is_block_start(i)) {
+            return false;
+        }
+        i += 2;
+
+        int64_t auto_value = 0;
+        while (i < tokens.size()) {
+            while (i < tokens.size() && tokens[i].type == TokenType::NEWLINE) i++;
+            if (i >= tokens.size() || tokens[i].type == TokenType::END) {
+                break;
+            }
+            if (tokens[i].type != TokenType::IDENTIFIER) {
+                return false;
+            }
+            const Token& member = tokens[i++];
+
+            ValuePtr value;
+            if (i < tokens.size() && tokens[i].type == TokenType::ASSIGN) {
+                if (i + 1 >= tokens.size() || tokens[i + 1].type != TokenType::NUMBER) {
+                    return false;
+                }
+                value = literal_value(tokens[i + 1]);
+                if (value == nullptr) {
+                    return false;
+                }
+                def.members.insert_or_assign(member.value, tokens[i + 1]);
+                auto_value = value->to_int() + 1;
+                i += 2;
+            } else {
+                Token literal = member;
+                if (!make_literal(Value::make_int(auto_value), member, literal)) {
+                    return false;
+                }
+                def.members.insert_or_assign(member.value, literal);
+                auto_value++;
+            }
+            if (i < tokens.size() && tokens[i].type != TokenType::NEWLINE && tokens[i].type != TokenType::END) {
+                return false;
+            }
+        }
+
+        if (!is_block_end(i)) {
+            return false;
+        }
+        def.defined_at = i + 2;
+        return true;
+    }
+
+    // ===== Dead branch removal =====
+
+    // Drop `IF <false literal>: START: ... END:` blocks
+    void remove_dead_branches() {
+        std::vector<Token> out;
+        out.reserve(tokens.size());
+
+        for (size_t i = 0; i < tokens.size(); i++) {
+            if (tokens[i].type == TokenType::IF && is_statement_start(i) && i + 2 < tokens.size() &&
+                is_literal(tokens[i + 1]) && tokens[i + 2].type == TokenType::COLON) {
+                ValuePtr condition = literal_value(tokens[i + 1]);
+                size_t start = i + 3;
+                while (start < tokens.size() && tokens[start].type == TokenType::NEWLINE) start++;
+                if (condition != nullptr && !condition->is_truthy() && is_block_start(start)) {
+                    size_t end = find_block_end(start);
+                    if (end < tokens.size()) {
+                        i = end + 1;  // Skip through END:
+                        continue;
+                    }
+                }
+            }
+            out.push_back(tokens[i]);
+        }
+
+        tokens.swap(out);
+    }
+
+    // ===== Function inlining =====
+
+    // FUNC name(a, b): START: RETURN <expression> END: at the top level
+    struct InlineCandidate {
+        size_t defined_at;  // Index just past the definition
+        std::vector<std::string> params;
+        std::vector<Token> body;  // The returned expression
+        std::vector<int> param_uses;
+        std::vector<bool> param_postfix;  // Used as p.member or p[index]
+        bool has_free_names;  // Reads names other than its parameters
+    };
+
+    static bool is_inline_barrier(const Token& token) {
+        return token.type == TokenType::LAMBDA || token.type == TokenType::YIELD ||
+               token.type == TokenType::AWAIT || token.type == TokenType::RETURN ||
+               token.type == TokenType::SPREAD || token.type == TokenType::INCREMENT ||
+               token.type == TokenType::DECREMENT ||
+               (token.type == TokenType::STRING && is_template(token));
+    }
+
+    bool parse_inline_candidate(size_t pos, InlineCandidate& candidate) const {
+        size_t i = pos + 2;
+        if (i >= tokens.size() || tokens[i].type != TokenType::LPAREN) {
+            return false;
+        }
+        i++;
+        while (i < tokens.size() && tokens[i].type != TokenType::RPAREN) {
+            if (tokens[i].type != TokenType::IDENTIFIER) {
+                return false;  // Defaults and *args keep the full call path
+            }
+            candidate.params.push_back(tokens[i].value);
+            i++;
+            if (i < tokens.size() && tokens[i].type == TokenType::COMMA) {
+                i++;
+            }
+        }
+        i++;
+        if (i >= tokens.size() || tokens[i].type != TokenType::COLON) {
+            return false;
+        }
+        i++;
+        while (i < tokens.size() && tokens[i].type == TokenType::NEWLINE) i++;
+        if (!is_block_start(i)) {
+            return false;
+        }
+        i += 2;
+        while (i < tokens.size() && tokens[i].type == TokenType::NEWLINE) i++;
+        if (i >= tokens.size() || tokens[i].type != TokenType::RETURN) {
+            return false;
+        }
+        i++;
+
+        while (i < tokens.size() && tokens[i].type != TokenType::NEWLINE && !is_block_end(i)) {
+            if (is_inline_barrier(tokens[i]) || tokens[i].type == TokenType::EOF_TOKEN) {
+                return false;
+            }
+            candidate.body.push_back(tokens[i]);
+            i++;
+        }
+        while (i < tokens.size() && tokens[i].type == TokenType::NEWLINE) i++;
+        if (candidate.body.empty() || candidate.body.size() > inline_limit || !is_block_end(i)) {
+            return false;
+        }
+        candidate.defined_at = i + 2;
+        return true;
+    }
+
+    // Classify the names the body reads; false when it cannot be inlined
+    bool analyze_inline_body(const std::string& name, InlineCandidate& candidate,
+                             const std::set<std::string>& rebound) const {
+        candidate.param_uses.assign(candidate.params.size(), 0);
+        candidate.param_postfix.assign(candidate.params.size(), false);
+        candidate.has_free_names = false;
+        const std::vector<Token>& body = candidate.body;
+
+        for (size_t i = 0; i < body.size(); i++) {
+            if (body[i].type != TokenType::IDENTIFIER || (i > 0 && body[i - 1].type == TokenType::DOT)) {
+                continue;
+            }
+            TokenType next = i + 1 < body.size() ? body[i + 1].type : TokenType::EOF_TOKEN;
+            auto param = std::find(candidate.params.begin(), candidate.params.end(), body[i].value);
+            if (param != candidate.params.end()) {
+                if (next == TokenType::LPAREN) {
+                    return false;
+                }
+                size_t index = param - candidate.params.begin();
+                candidate.param_uses[index]++;
+                if (next == TokenType::DOT || next == TokenType::LBRACKET) {
+                    candidate.param_postfix[index] = true;
+                }
+            } else if (next == TokenType::LPAREN) {
+                // A call; must not recurse or be shadowed by a variable
+                if (body[i].value == name || rebound.count(body[i].value)) {
+                    return false;
+                }
+            } else {
+                candidate.has_free_names = true;
+            }
+        }
+        return true;
+    }
+
+    // Split the arguments of the call whose '(' is at `open`; returns the
+    // index of the closing ')' or 0 when the call is unsuitable
+    size_t split_call_arguments(size_t open, std::vector<std::pair<size_t, size_t>>& args) const {
+        int depth = 0;
+        size_t arg_start = open + 1;
+        for (size_t i = open; i < tokens.size(); i++) {
+            TokenType type = tokens[i].type;
+            if (type == TokenType::NEWLINE || type == TokenType::EOF_TOKEN || is_inline_barrier(tokens[i])) {
+                return 0;
+            }
+            if (type == TokenType::LPAREN || type == TokenType::LBRACKET || type == TokenType::LBRACE) {
+                if (type == TokenType::LPAREN && depth > 0 && i > 0 &&
+                    (ends_operand(tokens[i - 1].type) || tokens[i - 1].type == TokenType::PRINT)) {
+                    return 0;  // Nested call: arguments must be side-effect free
+                }
+                depth++;
+            } else if (type == TokenType::RPAREN || type == TokenType::RBRACKET || type == TokenType::RBRACE) {
+                if (--depth == 0) {
+                    if (i > arg_start) {
+                        args.push_back({arg_start, i});
+                    } else if (!args.empty()) {
+                        return 0;
+                    }
+                    return i;
+                }
+            } else if (type == TokenType::COMMA && depth == 1) {
+                if (i == arg_start) {
+                    return 0;
+                }
+                args.push_back({arg_start, i});
+                arg_start = i + 1;
+            }
+        }
+        return 0;
+    }
+
+    bool inline_functions() {
+        std::set<std::string> rebound = collect_rebound_names();
+        std::map<std::string, int> definitions;
+        std::set<std::string> class_names;
+        for (size_t i = 0; i + 1 < tokens.size(); i++) {
+            if (tokens[i + 1].type == TokenType::IDENTIFIER) {
+                if (tokens[i].type == TokenType::FUNC) {
+                    definitions[tokens[i + 1].value]++;
+                } else if (tokens[i].type == TokenType::CLASS) {
+                    class_names.insert(tokens[i + 1].value);
+                }
+            }
+        }
+
+        std::map<std::string, InlineCandidate> candidates;
+        int depth = 0;
+        for (size_t i = 0; i + 1 < tokens.size(); i++) {
+            if (is_block_start(i)) {
+                depth++;
+            } else if (is_block_end(i)) {
+                depth--;
+            }
+            if (depth != 0 || tokens[i].type != TokenType::FUNC || !is_statement_start(i) ||
+                tokens[i + 1].type != TokenType::IDENTIFIER) {
+                continue;
+            }
+            const std::string& name = tokens[i + 1].value;
+            InlineCandidate candidate;
+            if (definitions[name] == 1 && !rebound.count(name) && !class_names.count(name) &&
+                parse_inline_candidate(i, candidate) && analyze_inline_body(name, candidate, rebound)) {
+                candidates.emplace(name, std::move(candidate));
+            }
+        }
+        if (candidates.empty()) {
+            return false;
+        }
+
+        // Free names in an inlined body must still resolve globally, so those
+        // bodies are only inlined outside function and class bodies
+        std::vector<Token> out;
+        out.reserve(tokens.size());
+        std::vector<bool> scope_stack;  // Per open block: inside a FUNC/CLASS body
+        bool pending_scope = false;
+        bool in_lambda = false;
+        bool changed = false;
+
+        for (size_t i = 0; i < tokens.size(); i++) {
+            const Token& token = tokens[i];
+            if (token.type == TokenType::FUNC || token.type == TokenType::CLASS) {
+                pending_scope = true;
+            } else if (token.type == TokenType::LAMBDA) {
+                in_lambda = true;
+            } else if (token.type == TokenType::NEWLINE) {
+                in_lambda = false;
+            } else if (is_block_start(i)) {
+                bool enclosing = !scope_stack.empty() && scope_stack.back();
+                scope_stack.push_back(enclosing || pending_scope);
+                pending_scope = false;
+            } else if (is_block_end(i) && !scope_stack.empty()) {
+                scope_stack.pop_back();
+            }
+
+            auto candidate_it = candidates.end();
+            if (token.type == TokenType::IDENTIFIER && i + 1 < tokens.size() &&
+                tokens[i + 1].type == TokenType::LPAREN && !in_lambda && !is_statement_start(i) &&
+                tokens[i - 1].type != TokenType::DOT && tokens[i - 1].type != TokenType::FUNC) {
+                candidate_it = candidates.find(token.value);
+            }
+            if (candidate_it == candidates.end() || i < candidate_it->second.defined_at ||
+                (candidate_it->second.has_free_names && !scope_stack.empty() && scope_stack.back())) {
+                out.push_back(token);
+                continue;
+            }
+
+            const InlineCandidate& candidate = candidate_it->second;
+            std::vector<std::pair<size_t, size_t>> args;
+            size_t close = split_call_arguments(i + 1, args);
+            bool usable = close != 0 && args.size() == candidate.params.size();
+            for (size_t a = 0; usable && a < args.size(); a++) {
+                bool single = args[a].second - args[a].first == 1;
+                // Compound arguments are evaluated exactly once, single tokens
+                // at least once so an undefined name still raises
+                usable = single ? (candidate.param_uses[a] > 0 || is_literal(tokens[args[a].first]))
+                                : candidate.param_uses[a] == 1;
+                // Member access and indexing are only parsed after a name
+                if (candidate.param_postfix[a] && (!single || tokens[args[a].first].type != TokenType::IDENTIFIER)) {
+                    usable = false;
+                }
+            }
+            if (!usable) {
+                out.push_back(token);
+                continue;
+            }
+
+            out.push_back(Token(TokenType::LPAREN, "(", token.line, token.column));
+            for (size_t b = 0; b < candidate.body.size(); b++) {
+                const Token& body_token = candidate.body[b];
+                size_t param = candidate.params.size();
+                if (body_token.type == TokenType::IDENTIFIER && (b == 0 || candidate.body[b - 1].type != TokenType::DOT)) {
+                    param = std::find(candidate.params.begin(), candidate.params.end(), body_token.value) -
+                            candidate.params.begin();
+                }
+                if (param == candidate.params.size()) {
+                    Token copy = body_token;
+                    copy.line = token.line;
+                    copy.column = token.column;
+                    out.push_back(copy);
+                    continue;
+                }
+                size_t arg_begin = args[param].first;
+                size_t arg_end = args[param].second;
+                bool single = arg_end - arg_begin == 1;
+                if (!single) {
+                    out.push_back(Token(TokenType::LPAREN, "(", token.line, token.column));
+                }
+                out.insert(out.end(), tokens.begin() + arg_begin, tokens.begin() + arg_end);
+                if (!single) {
+                    out.push_back(Token(TokenType::RPAREN, ")", token.line, token.column));
+                }
+            }
+            out.push_back(Token(TokenType::RPAREN, ")", token.line, token.column));
+            i = close;
+            changed = true;
+        }
+
+        tokens.swap(out);
+        return changed;
+    }
+};
+
+} // namespace susa
+
+#endif // SUSA_OPTIMIZER_HPP
@@ -0,0 +1,952 @@
+#ifndef SUSA_PROFILER_HPP
+#define SUSA_PROFILER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace susa {
+
+// Hardware performance counters behind `susa --profile=hw` (Linux only).
+//
+// Cycles, instructions, cache misses and branch misses of this thread are
+// opened as one perf_event group counting user space only, so one read()
+// returns all four from the same instant. open() fails, with the reason in
+// error(), where perf_event_open is missing, kernel.perf_event_paranoid
+// forbids it or no PMU is exposed (most virtual machines); callers then
+// profile without counters. An event the CPU lacks reads as zero. Samples
+// keep raw counts with the group's enabled and running times, so
+// differences never go negative; when the kernel multiplexes the group a
+// difference is scaled by its own share of time running.
+class HardwareCounters {
+public:
+    enum Event : uint8_t {
+        CYCLES,
+        INSTRUCTIONS,
+        CACHE_MISSES,
+        BRANCH_MISSES
+    };
+    static constexpr size_t EVENT_COUNT = 4;
+
+    struct Sample {
+        uint64_t values[EVENT_COUNT] = {};  // Raw counts
+        uint64_t time_enabled = 0;          // Nanoseconds the group was enabled
+        uint64_t time_running = 0;          // ... and actually counting
+
+        // Count of `event`, scaled up when the group only ran part of the time
+        uint64_t operator[](Event event) const {
+            if (time_running == 0 || time_running >= time_enabled) {
+                return values[event];
+            }
+            return static_cast<uint64_t>(static_cast<double>(values[event]) * time_enabled / time_running);
+        }
+
+        Sample& operator+=(const Sample& other) {
+            for (size_t i = 0; i < EVENT_COUNT; i++) {
+                values[i] += other.values[i];
+            }
+            time_enabled += other.time_enabled;
+            time_running += other.time_running;
+            return *this;
+        }
+
+        // Only for an earlier reading (or a part of this interval)
+        Sample& operator-=(const Sample& other) {
+            for (size_t i = 0; i < EVENT_COUNT; i++) {
+                values[i] -= other.values[i];
+            }
+            time_enabled -= other.time_enabled;
+            time_running -= other.time_running;
+            return *this;
+        }
+
+        Sample operator-(const Sample& other) const {
+            Sample difference = *this;
+            return difference -= other;
+        }
+    };
+
+    HardwareCounters() = default;
+
+    ~HardwareCounters() {
+        close();
+    }
+
+    HardwareCounters(const HardwareCounters&) = delete;
+    HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+    static const char* event_name(Event event) {
+        switch (event) {
+            case CYCLES: return "cycles";
+            case INSTRUCTIONS: return "instructions";
+            case CACHE_MISSES: return "cache-misses";
+            case BRANCH_MISSES: return "branch-misses";
+        }
+        return "";
+    }
+
+    // Opens and starts the counters; false (see error()) when unavailable
+    bool open() {
+        close();
+#ifdef __linux__
+        static const uint64_t configs[EVENT_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (size_t i = 0; i < EVENT_COUNT; i++) {
+            perf_event_attr attr = {};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.disabled = i == CYCLES ? 1 : 0;  // The group starts with its leader
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                               PERF_FORMAT_TOTAL_TIME_RUNNING;
+            int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, i == CYCLES ? -1 : fds[CYCLES], 0));
+            if (fd < 0) {
+                if (i == CYCLES) {
+                    failure = open_error(errno);
+                    return false;
+                }
+                continue;
+            }
+            fds[i] = fd;
+            slots[i] = static_cast<int>(members++);
+        }
+        ioctl(fds[CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return true;
+#else
+        failure = "perf_event_open needs Linux";
+        return false;
+#endif
+    }
+
+    void close() {
+#ifdef __linux__
+        for (size_t i = EVENT_COUNT; i-- > 0;) {
+            if (fds[i] >= 0) {
+                ::close(fds[i]);
+            }
+            fds[i] = -1;
+            slots[i] = -1;
+        }
+#endif
+        members = 0;
+    }
+
+    // Whether the CPU counts `event` (open() succeeded and it joined the group)
+    bool has(Event event) const {
+        return slots[event] >= 0;
+    }
+
+    // Counts since open()
+    Sample read() const {
+        Sample sample;
+#ifdef __linux__
+        uint64_t buffer[3 + EVENT_COUNT];  // Events, time enabled, time running, values
+        if (fds[CYCLES] < 0 || ::read(fds[CYCLES], buffer, sizeof(buffer)) < 0) {
+            return sample;
+        }
+        sample.time_enabled = buffer[1];
+        sample.time_running = buffer[2];
+        if (sample.time_running < sample.time_enabled) {
+            multiplexed = true;
+        }
+        for (size_t i = 0; i < EVENT_COUNT; i++) {
+            if (slots[i] >= 0) {
+                sample.values[i] = buffer[3 + slots[i]];
+            }
+        }
+#endif
+        return sample;
+    }
+
+    // Whether the group was multiplexed, so figures are scaled estimates
+    bool scaled() const {
+        return multiplexed;
+    }
+
+    const std::string& error() const {
+        return failure;
+    }
+
+private:
+    int fds[EVENT_COUNT] = {-1, -1, -1, -1};
+    int slots[EVENT_COUNT] = {-1, -1, -1, -1};  // Position in a group read (-1: not counted)
+    size_t members = 0;
+    mutable bool multiplexed = false;
+    std::string failure;
+
+#ifdef __linux__
+    static std::string open_error(int code) {
+        switch (code) {
+            case EACCES:
+            case EPERM: {
+                std::string reason = "not permitted";
+                FILE* file = std::fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+                int level;
+                if (file != nullptr) {
+                    if (std::fscanf(file, "%d", &level) == 1) {
+                        reason += " (kernel.perf_event_paranoid is " + std::to_string(level) + ")";
+                    }
+                    std::fclose(file);
+                }
+                return reason;
+            }
+            case ENOENT:
+            case ENODEV:
+            case EOPNOTSUPP:
+                return "no hardware PMU exposed (virtual machine?)";
+            case ENOSYS:
+                return "perf_event_open is not supported by this kernel";
+            default:
+                return std::strerror(code);
+        }
+    }
+#endif
+};
+
+// Deterministic profiler behind `susa --profile`.
+//
+// The interpreter reports every call it makes (user functions, methods,
+// lambdas and builtin/module functions) through enter()/leave() and every
+// statement it starts through line_hit(). Per callee it keeps the number of
+// calls, inclusive time (counted once for recursive calls, from the
+// outermost active frame) and exclusive time (inclusive minus callees).
+// With hardware counters attached (--profile=hw) every call and phase also
+// reads them, and the counts are attributed the same way as time.
+class Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Kind : uint8_t {
+        FUNCTION,
+        METHOD,
+        LAMBDA,
+        BUILTIN
+    };
+
+    Profiler() : started(Clock::now()), stopped(started) {}
+
+    static const char* kind_name(Kind kind) {
+        switch (kind) {
+            case Kind::FUNCTION: return "function";
+            case Kind::METHOD: return "method";
+            case Kind::LAMBDA: return "lambda";
+            case Kind::BUILTIN: return "builtin";
+        }
+        return "";
+    }
+
+    // `owner` qualifies the name: a class for methods, a module for builtins
+    void enter(Kind kind, const std::string& name, const std::string* owner = nullptr) {
+        Entry* entry;
+        if (owner == nullptr || owner->empty()) {
+            entry = &entries[name];
+        } else {
+            entry = &entries[*owner + "." + name];
+        }
+        entry->kind = kind;
+        entry->calls++;
+        entry->active++;
+        frames.push_back({entry, Clock::now(), Clock::duration::zero(), {}, {}});
+        if (counters != nullptr) {
+            frames.back().start_events = counters->read();
+        }
+    }
+
+    void leave() {
+        HardwareCounters::Sample events;
+        if (counters != nullptr) {
+            events = counters->read();
+        }
+        Frame frame = frames.back();
+        frames.pop_back();
+        Clock::duration elapsed = Clock::now() - frame.start;
+        frame.entry->exclusive += elapsed - frame.children;
+        if (--frame.entry->active == 0) {
+            frame.entry->inclusive += elapsed;
+        }
+        if (!frames.empty()) {
+            frames.back().children += elapsed;
+        }
+        if (counters != nullptr) {
+            events -= frame.start_events;
+            frame.entry->exclusive_events += events - frame.children_events;
+            if (!frames.empty()) {
+                frames.back().children_events += events;
+            }
+        }
+    }
+
+    // Read `active_counters` (opened by the caller) on every call and phase
+    void set_counters(HardwareCounters* active_counters) {
+        counters = active_counters;
+    }
+
+    // Interpreter phases (lex, optimize, execute); only recorded with counters
+    void begin_phase(const char* name) {
+        if (counters == nullptr) {
+            return;
+        }
+        phase_name = name;
+        phase_start = Clock::now();
+        phase_events = counters->read();
+    }
+
+    void end_phase() {
+        if (counters == nullptr || phase_name == nullptr) {
+            return;
+        }
+        HardwareCounters::Sample events = counters->read() - phase_events;
+        Clock::duration elapsed = Clock::now() - phase_start;
+        auto phase = std::find_if(phases.begin(), phases.end(),
+                                  [this](const Phase& p) { return std::strcmp(p.name, phase_name) == 0; });
+        if (phase == phases.end()) {
+            phases.push_back({phase_name, Clock::duration::zero(), {}});
+            phase = phases.end() - 1;
+        }
+        phase->time += elapsed;
+        phase->events += events;
+        phase_name = nullptr;
+    }
+
+    // Values the run created, for the allocation rate in the counter summary
+    void count_allocations(uint64_t values) {
+        allocations += values;
+    }
+
+    void line_hit(int line) {
+        if (line < 0) {
+            return;
+        }
+        if (static_cast<size_t>(line) >= line_hits.size()) {
+            line_hits.resize(line + 1, 0);
+        }
+        line_hits[line]++;
+    }
+
+    // End of the profiled run; the report's total time
+    void stop() {
+        stopped = Clock::now();
+    }
+
+    // Callees by exclusive time, then the hottest lines with their source
+    void report(std::ostream& out, const std::string& source, size_t max_lines = 25) const {
+        double total_ms = milliseconds(stopped - started);
+        char row[160];
+
+        out << "\n=== Profile (wall time " << format_ms(total_ms) << " ms) ===\n";
+        std::snprintf(row, sizeof(row), "%10s %12s %12s %7s  %-8s %s\n",
+                      "calls", "incl ms", "excl ms", "excl %", "kind", "name");
+        out << row;
+
+        std::vector<std::pair<const std::string*, const Entry*>> sorted;
+        for (const auto& entry : entries) {
+            sorted.push_back({&entry.first, &entry.second});
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+            if (a.second->exclusive != b.second->exclusive) {
+                return a.second->exclusive > b.second->exclusive;
+            }
+            return *a.first < *b.first;
+        });
+        for (const auto& entry : sorted) {
+            double exclusive_ms = milliseconds(entry.second->exclusive);
+            double share = total_ms > 0 ? exclusive_ms * 100.0 / total_ms : 0.0;
+            std::snprintf(row, sizeof(row), "%10llu %12.3f %12.3f %6.1f%%  %-8s %s\n",
+                          static_cast<unsigned long long>(entry.second->calls),
+                          milliseconds(entry.second->inclusive), exclusive_ms, share,
+                          kind_name(entry.second->kind), entry.first->c_str());
+            out << row;
+        }
+        if (sorted.empty()) {
+            out << "  (no calls)\n";
+        }
+        if (counters != nullptr) {
+            report_counters(out, sorted);
+        }
+
+        std::vector<size_t> lines;
+        for (size_t line = 0; line < line_hits.size(); line++) {
+            if (line_hits[line] > 0) {
+                lines.push_back(line);
+            }
+        }
+        std::stable_sort(lines.begin(), lines.end(), [this](size_t a, size_t b) {
+            return line_hits[a] > line_hits[b];
+        });
+        if (lines.size() > max_lines) {
+            lines.resize(max_lines);
+        }
+
+        std::vector<std::string> source_lines = split_lines(source);
+        out << "\n=== Line hits (top " << lines.size() << ") ===\n";
+        std::snprintf(row, sizeof(row), "%10s %6s  %s\n", "hits", "line", "source");
+        out << row;
+        for (size_t line : lines) {
+            std::string text = line >= 1 && line <= source_lines.size() ? source_lines[line - 1] : "";
+            size_t first = text.find_first_not_of(" \t");
+            text = first == std::string::npos ? "" : text.substr(first);
+            std::snprintf(row, sizeof(row), "%10llu %6zu  ",
+                          static_cast<unsigned long long>(line_hits[line]), line);
+            out << row << text << "\n";
+        }
+    }
+
+private:
+    struct Entry {
+        Kind kind = Kind::FUNCTION;
+        uint64_t calls = 0;
+        Clock::duration inclusive = Clock::duration::zero();
+        Clock::duration exclusive = Clock::duration::zero();
+        int active = 0;  // Frames of this callee currently on the stack
+        HardwareCounters::Sample exclusive_events;
+    };
+
+    struct Frame {
+        Entry* entry;
+        Clock::time_point start;
+        Clock::duration children;  // Time spent in callees
+        HardwareCounters::Sample start_events;
+        HardwareCounters::Sample children_events;
+    };
+
+    struct Phase {
+        const char* name;
+        Clock::duration time;
+        HardwareCounters::Sample events;
+    };
+
+    std::unordered_map<std::string, Entry> entries;
+    std::vector<Frame> frames;
+    std::vector<uint64_t> line_hits;
+    Clock::time_point started;
+    Clock::time_point stopped;
+    HardwareCounters* counters = nullptr;
+    std::vector<Phase> phases;
+    const char* phase_name = nullptr;  // Open phase
+    Clock::time_point phase_start;
+    HardwareCounters::Sample phase_events;
+    uint64_t allocations = 0;
+
+    // Events per 1000 instructions
+    static double per_kilo_instruction(uint64_t count, const HardwareCounters::Sample& events) {
+        uint64_t instructions = events[HardwareCounters::INSTRUCTIONS];
+        return instructions > 0 ? count * 1000.0 / instructions : 0.0;
+    }
+
+    static double instructions_per_cycle(const HardwareCounters::Sample& events) {
+        uint64_t cycles = events[HardwareCounters::CYCLES];
+        return cycles > 0 ? static_cast<double>(events[HardwareCounters::INSTRUCTIONS]) / cycles : 0.0;
+    }
+
+    // Counters per phase, callees by exclusive cycles, and what the execute
+    // phase's miss rates suggest it is bound by
+    void report_counters(std::ostream& out,
+                         std::vector<std::pair<const std::string*, const Entry*>> sorted,
+                         size_t max_rows = 15) const {
+        using Counters = HardwareCounters;
+        char row[160];
+        out << "\n=== Hardware counters (user space; misses per 1k instructions) ===\n";
+        std::snprintf(row, sizeof(row), "%-10s %10s %14s %14s %6s %8s %8s\n",
+                      "phase", "ms", "cycles", "instructions", "IPC", "cache", "branch");
+        out << row;
+        Counters::Sample execute;
+        for (const Phase& phase : phases) {
+            const Counters::Sample& events = phase.events;
+            std::snprintf(row, sizeof(row), "%-10s %10.3f %14llu %14llu %6.2f %8.2f %8.2f\n", phase.name,
+                          milliseconds(phase.time), static_cast<unsigned long long>(events[Counters::CYCLES]),
+                          static_cast<unsigned long long>(events[Counters::INSTRUCTIONS]),
+                          instructions_per_cycle(events),
+                          per_kilo_instruction(events[Counters::CACHE_MISSES], events),
+                          per_kilo_instruction(events[Counters::BRANCH_MISSES], events));
+            out << row;
+            if (std::strcmp(phase.name, "execute") == 0) {
+                execute = phase.events;
+            }
+        }
+
+        std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+            return a.second->exclusive_events[Counters::CYCLES] > b.second->exclusive_events[Counters::CYCLES];
+        });
+        if (sorted.size() > max_rows) {
+            sorted.resize(max_rows);
+        }
+        uint64_t execute_cycles = execute[Counters::CYCLES];
+        out << "\nTop callees by exclusive cycles:\n";
+        std::snprintf(row, sizeof(row), "%10s %14s %7s %6s %8s %8s  %s\n",
+                      "calls", "excl cycles", "cyc %", "IPC", "cache", "branch", "name");
+        out << row;
+        for (const auto& entry : sorted) {
+            const Counters::Sample& events = entry.second->exclusive_events;
+            uint64_t cycles = events[Counters::CYCLES];
+            std::snprintf(row, sizeof(row), "%10llu %14llu %6.1f%% %6.2f %8.2f %8.2f  %s\n",
+                          static_cast<unsigned long long>(entry.second->calls),
+                          static_cast<unsigned long long>(cycles),
+                          execute_cycles > 0 ? cycles * 100.0 / execute_cycles : 0.0,
+                          instructions_per_cycle(events),
+                          per_kilo_instruction(events[Counters::CACHE_MISSES], events),
+                          per_kilo_instruction(events[Counters::BRANCH_MISSES], events),
+                          entry.first->c_str());
+            out << row;
+        }
+        if (sorted.empty()) {
+            out << "  (no calls)\n";
+        }
+
+        // Rough thresholds: an interpreter that dispatches well misses a few
+        // branches and almost no last-level cache lines per 1k instructions,
+        // and each Value it creates costs a few hundred instructions
+        if (execute[Counters::INSTRUCTIONS] == 0) {
+            if (execute_cycles == 0 && !phases.empty()) {
+                out << "\nThe counters did not run (another tool may hold the PMU)\n";
+            }
+            return;
+        }
+        double cache = per_kilo_instruction(execute[Counters::CACHE_MISSES], execute);
+        double branch = per_kilo_instruction(execute[Counters::BRANCH_MISSES], execute);
+        double values = per_kilo_instruction(allocations, execute);
+        std::snprintf(row, sizeof(row),
+                      "\nexecute: IPC %.2f, %.2f cache and %.2f branch misses, %.2f Values created per 1k instructions\n",
+                      instructions_per_cycle(execute), cache, branch, values);
+        out << row;
+        std::string bound;
+        if (branch >= 5.0) {
+            bound += ", dispatch (mispredicted branches)";
+        }
+        if (values >= 2.0) {
+            bound += ", allocation (Values created)";
+        }
+        if (cache >= 2.0) {
+            bound += ", memory (cache misses)";
+        }
+        out << "Likely bound by: "
+            << (bound.empty() ? "instruction count (no miss rate stands out)" : bound.substr(2)) << "\n";
+        for (size_t i = 0; i < Counters::EVENT_COUNT; i++) {
+            if (!counters->has(static_cast<Counters::Event>(i))) {
+                out << "Note: " << Counters::event_name(static_cast<Counters::Event>(i))
+                    << " is not counted on this CPU\n";
+            }
+        }
+        if (counters->scaled()) {
+            out << "Note: the counters were multiplexed; figures are scaled estimates\n";
+        }
+    }
+
+    static double milliseconds(Clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    static std::string format_ms(double ms) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.3f", ms);
+        return text;
+    }
+
+    static std::vector<std::string> split_lines(const std::string& source) {
+        std::vector<std::string> lines;
+        size_t start = 0;
+        while (start <= source.size()) {
+            size_t end = source.find('\n', start);
+            if (end == std::string::npos) {
+                end = source.size();
+            }
+            std::string line = source.substr(start, end - start);
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            lines.push_back(line);
+            start = end + 1;
+        }
+        return lines;
+    }
+};
+
+// Chrome trace-event recorder behind `susa --trace out.json`.
+//
+// Spans (calls, imports and the lex / optimize / execute phases) are kept
+// as complete ("X") events with microsecond timestamps and written as
+// {"traceEvents": [...]} for chrome://tracing or Perfetto. Names are
+// interned, so a span costs two clock reads and one small record. Past
+// MAX_EVENTS further spans are counted but not kept.
+class Tracer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t MAX_EVENTS = 2000000;
+
+    Tracer() : started(Clock::now()) {}
+
+    // `category` must be a string literal; `owner` qualifies the name as
+    // in Profiler::enter()
+    void begin(const char* category, const std::string& name, const std::string* owner = nullptr) {
+        if (events.size() >= MAX_EVENTS) {
+            open.push_back(DROPPED);
+            dropped++;
+            return;
+        }
+        uint32_t id = owner == nullptr || owner->empty() ? intern(name) : intern(*owner + "." + name);
+        open.push_back(events.size());
+        events.push_back({id, category, Clock::now() - started, Clock::duration::zero()});
+    }
+
+    void end() {
+        size_t index = open.back();
+        open.pop_back();
+        if (index != DROPPED) {
+            events[index].duration = Clock::now() - started - events[index].start;
+        }
+    }
+
+    void write_json(std::ostream& out) const {
+        char number[64];
+        out << "{\"traceEvents\": [\n";
+        out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, "
+            << "\"args\": {\"name\": \"susa\"}}";
+        for (const Event& event : events) {
+            out << ",\n{\"name\": \"" << json_escape(names[event.name]) << "\", \"cat\": \""
+                << event.category << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, ";
+            std::snprintf(number, sizeof(number), "\"ts\": %.3f, \"dur\": %.3f}",
+                          microseconds(event.start), microseconds(event.duration));
+            out << number;
+        }
+        out << "\n], \"displayTimeUnit\": \"ms\", \"otherData\": {\"dropped_events\": " << dropped
+            << "}}\n";
+    }
+
+    size_t event_count() const {
+        return events.size();
+    }
+
+private:
+    static constexpr size_t DROPPED = SIZE_MAX;
+
+    struct Event {
+        uint32_t name;
+        const char* category;
+        Clock::duration start;
+        Clock::duration duration;
+    };
+
+    std::vector<Event> events;
+    std::vector<size_t> open;  // Events of the spans not yet ended
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> name_ids;
+    uint64_t dropped = 0;
+    Clock::time_point started;
+
+    uint32_t intern(const std::string& name) {
+        auto it = name_ids.find(name);
+        if (it != name_ids.end()) {
+            return it->second;
+        }
+        uint32_t id = static_cast<uint32_t>(names.size());
+        names.push_back(name);
+        name_ids.emplace(name, id);
+        return id;
+    }
+
+    static double microseconds(Clock::duration duration) {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    }
+
+    static std::string json_escape(const std::string& text) {
+        std::string escaped;
+        for (unsigned char c : text) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+                escaped += static_cast<char>(c);
+            } else if (c < 0x20) {
+                char code[8];
+                std::snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            } else {
+                escaped += static_cast<char>(c);
+            }
+        }
+        return escaped;
+    }
+};
+
+// One span (a phase or an import) for an optional tracer
+class TraceSpan {
+public:
+    TraceSpan(Tracer* active_tracer, const char* category, const std::string& name)
+        : tracer(active_tracer) {
+        if (tracer != nullptr) {
+            tracer->begin(category, name);
+        }
+    }
+
+    ~TraceSpan() {
+        if (tracer != nullptr) {
+            tracer->end();
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    Tracer* tracer;
+};
+
+// One interpreter phase (lex, optimize, execute) for an optional profiler
+// and tracer
+class PhaseScope {
+public:
+    PhaseScope(Profiler* active_profiler, Tracer* active_tracer, const char* name)
+        : profiler(active_profiler), span(active_tracer, "phase", name) {
+        if (profiler != nullptr) {
+            profiler->begin_phase(name);
+        }
+    }
+
+    ~PhaseScope() {
+        if (profiler != nullptr) {
+            profiler->end_phase();
+        }
+    }
+
+    PhaseScope(const PhaseScope&) = delete;
+    PhaseScope& operator=(const PhaseScope&) = delete;
+
+private:
+    Profiler* profiler;
+    TraceSpan span;
+};
+
+// Brackets one call for an optional profiler and tracer; leaving on
+// destruction keeps their stacks right when an error unwinds through the call
+class ProfileScope {
+public:
+    ProfileScope(Profiler* active_profiler, Tracer* active_tracer, Profiler::Kind kind,
+                 const std::string& name, const std::string* owner = nullptr)
+        : profiler(active_profiler), tracer(active_tracer) {
+        if (profiler != nullptr) {
+            profiler->enter(kind, name, owner);
+        }
+        if (tracer != nullptr) {
+            tracer->begin(Profiler::kind_name(kind), name, owner);
+        }
+    }
+
+    ~ProfileScope() {
+        if (tracer != nullptr) {
+            tracer->end();
+        }
+        if (profiler != nullptr) {
+            profiler->leave();
+        }
+    }
+
+    // The frame now runs another callee (a tail call)
+    void replace(Profiler::Kind kind, const std::string& name) {
+        if (tracer != nullptr) {
+            tracer->end();
+            tracer->begin(Profiler::kind_name(kind), name);
+        }
+        if (profiler != nullptr) {
+            profiler->leave();
+            profiler->enter(kind, name);
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler* profiler;
+    Tracer* tracer;
+};
+
+// Statistical profiler behind `susa --sample out.folded`.
+//
+// A SIGPROF interval timer (process CPU time) only bumps a counter; the
+// interpreter polls it once per statement and, when ticks are pending,
+// records its current call stack with that weight. Nothing is done per
+// call, so the cost is the poll plus one stack walk per tick. A tick that
+// lands in a builtin or a JIT-compiled loop is recorded at the next
+// statement, under the same SUSA stack. Output is folded stacks
+// ("<main>;f;g 42" per line) for flamegraph.pl or speedscope.
+// Not available on Windows (start() returns false).
+class SamplingProfiler {
+public:
+    static constexpr int DEFAULT_INTERVAL_US = 1000;
+
+    // Ticks not yet recorded; written by the signal handler
+    static inline volatile std::sig_atomic_t pending_ticks = 0;
+
+    static bool pending() {
+        return pending_ticks != 0;
+    }
+
+    ~SamplingProfiler() {
+        stop();
+    }
+
+    bool start(int interval_us = DEFAULT_INTERVAL_US) {
+#ifdef _WIN32
+        (void)interval_us;
+        return false;
+#else
+        struct sigaction action = {};
+        action.sa_handler = on_tick;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGPROF, &action, &previous_action) != 0) {
+            return false;
+        }
+        struct itimerval timer = {};
+        timer.it_interval.tv_sec = interval_us / 1000000;
+        timer.it_interval.tv_usec = interval_us % 1000000;
+        timer.it_value = timer.it_interval;
+        if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+            sigaction(SIGPROF, &previous_action, nullptr);
+            return false;
+        }
+        pending_ticks = 0;
+        running = true;
+        return true;
+#endif
+    }
+
+    void stop() {
+#ifndef _WIN32
+        if (!running) {
+            return;
+        }
+        struct itimerval timer = {};
+        setitimer(ITIMER_PROF, &timer, nullptr);
+        sigaction(SIGPROF, &previous_action, nullptr);
+        running = false;
+#endif
+    }
+
+    // Claim the pending ticks (a tick arriving meanwhile may be dropped)
+    static int take_ticks() {
+        int ticks = pending_ticks;
+        pending_ticks = 0;
+        return ticks;
+    }
+
+    void record(const std::string& folded_stack, int ticks) {
+        stacks[folded_stack] += ticks;
+        total += ticks;
+    }
+
+    uint64_t samples() const {
+        return total;
+    }
+
+    void write_folded(std::ostream& out) const {
+        std::vector<std::pair<std::string, uint64_t>> sorted(stacks.begin(), stacks.end());
+        std::sort(sorted.begin(), sorted.end());
+        for (const auto& stack : sorted) {
+            out << stack.first << " " << stack.second << "\n";
+        }
+    }
+
+private:
+    std::unordered_map<std::string, uint64_t> stacks;
+    uint64_t total = 0;
+    bool running = false;
+#ifndef _WIN32
+    struct sigaction previous_action = {};
+
+    static void on_tick(int) {
+        pending_ticks = pending_ticks + 1;
+    }
+#endif
+};
+
+// Operation histogram behind --stats: how often each statement kind,
+// assignment, comparison, call, method and index operation ran. Counting is
+// compiled in only when SUSA_STATS is defined (SUSA_STAT in the interpreter
+// expands to nothing otherwise), so normal builds pay nothing for it.
+class OpStats {
+public:
+#ifdef SUSA_STATS
+    static constexpr bool ENABLED = true;
+#else
+    static constexpr bool ENABLED = false;
+#endif
+
+    // `category` must be a string literal: categories are keyed by address
+    void count(const char* category, const std::string& name) {
+        counts[category][name]++;
+    }
+
+    uint64_t total() const {
+        uint64_t sum = 0;
+        for (const auto& category : counts) {
+            for (const auto& entry : category.second) {
+                sum += entry.second;
+            }
+        }
+        return sum;
+    }
+
+    void report(std::ostream& out, size_t max_rows = 60) const {
+        struct Row {
+            uint64_t count;
+            std::string name;
+        };
+        std::vector<Row> rows;
+        for (const auto& category : counts) {
+            for (const auto& entry : category.second) {
+                rows.push_back({entry.second, std::string(category.first) + " " + entry.first});
+            }
+        }
+        std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+            if (a.count != b.count) {
+                return a.count > b.count;
+            }
+            return a.name < b.name;
+        });
+
+        uint64_t sum = total();
+        char row[160];
+        out << "\n=== Operation histogram (" << sum << " operations, " << rows.size() << " kinds) ===\n";
+        std::snprintf(row, sizeof(row), "%14s %7s  %s\n", "count", "%", "operation");
+        out << row;
+        for (size_t i = 0; i < rows.size() && i < max_rows; i++) {
+            std::snprintf(row, sizeof(row), "%14llu %6.2f%%  %s\n", static_cast<unsigned long long>(rows[i].count),
+                          sum > 0 ? rows[i].count * 100.0 / sum : 0.0, rows[i].name.c_str());
+            out << row;
+        }
+        if (rows.size() > max_rows) {
+            out << "  ... " << rows.size() - max_rows << " less frequent kinds\n";
+        }
+        if (rows.empty()) {
+            out << "  (nothing counted)\n";
+        }
+    }
+
+private:
+    std::unordered_map<const char*, std::unordered_map<std::string, uint64_t>> counts;
+};
+
+}  // namespace susa
+
+#endif  // SUSA_PROFILER_HPP
@@ -6,16 +6,319 @@
 #include <map>
 #include <memory>
 #include <iostream>
+#include <charconv>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    #define SUSA_FP_CHARCONV 1
+#endif
 
 namespace susa {
 
+// Largest magnitude printed as a plain integer (beyond this doubles lose
+// integer precision, so the shortest round-trip form is used instead)
+constexpr double MAX_PLAIN_INTEGER = 9007199254740992.0;  // 2^53
+
+// Append a number in its shortest round-trip form ("3", "0.1", "1e+300")
+inline void append_number(std::string& out, double val) {
+    char buf[32];
+    char* end = buf;
+    
+    if (val == std::trunc(val) && std::fabs(val) <= MAX_PLAIN_INTEGER) {
+        end = std::to_chars(buf, buf + sizeof(buf), static_cast<long long>(val)).ptr;
+    } else {
+#ifdef SUSA_FP_CHARCONV
+        end = std::to_chars(buf, buf + sizeof(buf), val).ptr;
+#else
+        // No floating-point to_chars: pick the shortest %g precision that round-trips
+        int len = 0;
+        for (int precision = 15; precision <= 17; precision++) {
+            len = std::snprintf(buf, sizeof(buf), "%.*g", precision, val);
+            if (std::strtod(buf, nullptr) == val) break;
+        }
+        end = buf + len;
+#endif
+    }
+    
+    out.append(buf, end);
+}
+
+inline void append_integer(std::string& out, int64_t val) {
+    char buf[24];
+    char* end = std::to_chars(buf, buf + sizeof(buf), val).ptr;
+    out.append(buf, end);
+}
+
+inline std::string format_number(double val) {
+    std::string result;
+    append_number(result, val);
+    return result;
+}
+
+// Parse the leading number in a string (leading whitespace and '+' allowed,
+// trailing text ignored, like std::stod). Returns false if there is none.
+inline bool parse_number(const std::string& str, double& out) {
+    const char* first = str.data();
+    const char* last = first + str.size();
+    
+    while (first < last && std::isspace(static_cast<unsigned char>(*first))) first++;
+    if (first < last && *first == '+') first++;
+    
+#ifdef SUSA_FP_CHARCONV
+    auto result = std::from_chars(first, last, out);
+    return result.ec == std::errc();
+#else
+    std::string buf(first, last);
+    char* end = nullptr;
+    out = std::strtod(buf.c_str(), &end);
+    return end != buf.c_str();
+#endif
+}
+
+// Parse a whole string as a 64-bit integer literal ("42", not "4.2" or "1e3")
+inline bool parse_integer(const std::string& str, int64_t& out) {
+    const char* first = str.data();
+    const char* last = first + str.size();
+    auto result = std::from_chars(first, last, out);
+    return result.ec == std::errc() && result.ptr == last;
+}
+
+// Overflow-checked int64 arithmetic; false means the caller should promote to double
+inline bool checked_add(int64_t a, int64_t b, int64_t& out) {
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_add_overflow(a, b, &out);
+#else
+    if ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b)) return false;
+    out = a + b;
+    return true;
+#endif
+}
+
+inline bool checked_sub(int64_t a, int64_t b, int64_t& out) {
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_sub_overflow(a, b, &out);
+#else
+    if ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b)) return false;
+    out = a - b;
+    return true;
+#endif
+}
+
+inline bool checked_mul(int64_t a, int64_t b, int64_t& out) {
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_mul_overflow(a, b, &out);
+#else
+    if (a != 0 && b != 0) {
+        if ((a == -1 && b == INT64_MIN) || (b == -1 && a == INT64_MIN)) return false;
+        if (a > 0 ? (b > 0 ? a > INT64_MAX / b : b < INT64_MIN / a)
+                  : (b > 0 ? a < INT64_MIN / b : a < INT64_MAX / b)) return false;
+    }
+    out = a * b;
+    return true;
+#endif
+}
+
+// Saturating double -> int64 conversion (NaN maps to 0)
+inline int64_t double_to_int64(double val) {
+    if (!(val == val)) return 0;
+    if (val >= 9223372036854775807.0) return std::numeric_limits<int64_t>::max();
+    if (val <= -9223372036854775808.0) return std::numeric_limits<int64_t>::min();
+    return static_cast<int64_t>(val);
+}
+
 class Value;
 using ValuePtr = std::shared_ptr<Value>;
 
+// Hidden class describing the property layout of class instances. Instances
+// created by the same constructor path share one Shape, and their property
+// values live in a slot vector indexed by it. Adding a property moves an
+// instance along a cached transition to the child shape for that name.
+class Shape {
+public:
+    std::vector<std::string> names;                      // slot index -> property name
+    std::unordered_map<std::string, uint32_t> slot_of;   // property name -> slot index
+    uint32_t class_id = 0;                               // Class definition this layout belongs to
+    
+    static constexpr int NO_SLOT = -1;
+    
+    int find(const std::string& name) const {
+        auto it = slot_of.find(name);
+        return it == slot_of.end() ? NO_SLOT : static_cast<int>(it->second);
+    }
+    
+    // Shape with one more property appended (created once, then reused)
+    std::shared_ptr<Shape> add_property(const std::string& name) {
+        auto it = transitions.find(name);
+        if (it != transitions.end()) {
+            return it->second;
+        }
+        auto next = std::make_shared<Shape>();
+        next->class_id = class_id;
+        next->names = names;
+        next->names.push_back(name);
+        next->slot_of = slot_of;
+        next->slot_of[name] = static_cast<uint32_t>(names.size());
+        transitions[name] = next;
+        return next;
+    }
+    
+private:
+    std::map<std::string, std::shared_ptr<Shape>> transitions;
+};
+using ShapePtr = std::shared_ptr<Shape>;
+
+// Insertion-ordered hash map used for DICT values. Entries live in a dense
+// vector in insertion order; an open-addressing table of entry indices
+// (linear probing, power-of-two size) sits beside it. Erasing leaves a
+// tombstone in both (a null key, a DELETED_SLOT) that the next compaction
+// drops, once tombstones outnumber live entries or the table grows. Keys
+// may be strings, numbers or booleans; 1 and 1.0 are the same key, and so
+// are all NaNs.
+class Dict {
+public:
+    struct Entry {
+        ValuePtr key;  // nullptr: erased
+        ValuePtr value;
+        size_t hash;
+    };
+    
+    // Live entries in insertion order
+    class Items {
+    public:
+        class const_iterator {
+        public:
+            const_iterator(const Entry* position, const Entry* last) : at(position), end(last) {
+                skip_erased();
+            }
+            const Entry& operator*() const { return *at; }
+            const Entry* operator->() const { return at; }
+            const_iterator& operator++() {
+                ++at;
+                skip_erased();
+                return *this;
+            }
+            bool operator==(const const_iterator& other) const { return at == other.at; }
+            bool operator!=(const const_iterator& other) const { return at != other.at; }
+            
+        private:
+            const Entry* at;
+            const Entry* end;
+            
+            void skip_erased() {
+                while (at != end && at->key == nullptr) {
+                    ++at;
+                }
+            }
+        };
+        
+        explicit Items(const std::vector<Entry>& dict_entries) : entries(dict_entries) {}
+        const_iterator begin() const { return {entries.data(), entries.data() + entries.size()}; }
+        const_iterator end() const { return {entries.data() + entries.size(), entries.data() + entries.size()}; }
+        
+    private:
+        const std::vector<Entry>& entries;
+    };
+    
+    Dict() = default;
+    
+    size_t size() const { return live; }
+    bool empty() const { return live == 0; }
+    size_t capacity() const { return slots.size(); }
+    size_t heap_bytes() const {
+        return entries.capacity() * sizeof(Entry) + slots.capacity() * sizeof(int32_t);
+    }
+    Items items() const { return Items(entries); }
+    
+    static bool is_hashable(const ValuePtr& key);
+    
+    ValuePtr get(const ValuePtr& key) const;  // nullptr if missing
+    bool contains(const ValuePtr& key) const { return get(key) != nullptr; }
+    void set(const ValuePtr& key, const ValuePtr& value);
+    bool erase(const ValuePtr& key);
+    void reserve(size_t count);
+    
+    void clear() {
+        entries.clear();
+        slots.clear();
+        live = 0;
+    }
+    
+private:
+    static constexpr int32_t EMPTY_SLOT = -1;
+    static constexpr int32_t DELETED_SLOT = -2;  // Erased; probing continues past it
+    
+    std::vector<Entry> entries;
+    std::vector<int32_t> slots;
+    size_t live = 0;  // Entries not erased
+    
+    static size_t hash_key(const ValuePtr& key);
+    static bool keys_equal(const ValuePtr& a, const ValuePtr& b);
+    
+    // The int64 an integral double equals exactly, if it has one
+    static bool as_int64(double num, int64_t& out) {
+        if (num != std::trunc(num) || num < -9223372036854775808.0 || num >= 9223372036854775808.0) {
+            return false;
+        }
+        out = static_cast<int64_t>(num);
+        return true;
+    }
+    
+    // Slot holding the key, or the empty slot where it would be inserted
+    size_t probe(const ValuePtr& key, size_t hash) const {
+        size_t mask = slots.size() - 1;
+        size_t i = hash & mask;
+        while (slots[i] != EMPTY_SLOT) {
+            if (slots[i] != DELETED_SLOT) {
+                const Entry& entry = entries[slots[i]];
+                if (entry.hash == hash && keys_equal(entry.key, key)) {
+                    break;
+                }
+            }
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+    
+    // Rebuild the table over the live entries, dropping erased ones and
+    // keeping the order of the rest. The new table is filled before any
+    // entry moves, so an allocation failure leaves the dict as it was.
+    void rebuild(size_t capacity) {
+        std::vector<int32_t> table(capacity, EMPTY_SLOT);
+        size_t mask = capacity - 1;
+        size_t n = 0;
+        for (const Entry& entry : entries) {
+            if (entry.key == nullptr) {
+                continue;
+            }
+            size_t i = entry.hash & mask;
+            while (table[i] != EMPTY_SLOT) {
+                i = (i + 1) & mask;
+            }
+            table[i] = static_cast<int32_t>(n++);
+        }
+        if (live != entries.size()) {
+            entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                         [](const Entry& entry) { return entry.key == nullptr; }),
+                          entries.end());
+        }
+        slots.swap(table);
+    }
+};
+
 enum class ValueType {
     NULL_TYPE,
     BOOLEAN,
     NUMBER,
+    INTEGER,   // Exact 64-bit integer (promotes to NUMBER on overflow)
     STRING,
     LIST,
     DICT,
@@ -25,6 +328,31 @@ enum class ValueType {
     GENERATOR  // Generator instance
 };
 
+inline const char* value_type_name(ValueType type) {
+    switch (type) {
+        case ValueType::NULL_TYPE: return "NULL";
+        case ValueType::BOOLEAN: return "BOOL";
+        case ValueType::NUMBER: return "FLOAT";
+        case ValueType::INTEGER: return "INT";
+        case ValueType::STRING: return "STRING";
+        case ValueType::LIST: return "LIST";
+        case ValueType::DICT: return "DICT";
+        case ValueType::FUNCTION: return "FUNCTION";
+        case ValueType::LAMBDA: return "LAMBDA";
+        case ValueType::INSTANCE: return "INSTANCE";
+        case ValueType::GENERATOR: return "GENERATOR";
+    }
+    return "?";
+}
+
+// Values created on this thread (callers diff it around a run) and alive
+// right now, by type
+struct ValueCounters {
+    static constexpr size_t TYPE_COUNT = static_cast<size_t>(ValueType::GENERATOR) + 1;
+    static inline thread_local uint64_t created[TYPE_COUNT] = {};
+    static inline thread_local int64_t live[TYPE_COUNT] = {};
+};
+
 class Value {
 public:
     ValueType type;
@@ -32,9 +360,11 @@ public:
     // Data storage
     bool bool_value;
     double number_value;
+    int64_t int_value;
     std::string string_value;
+    mutable size_t string_hash;  // Cached hash of string_value (strings are never mutated in place), 0 = not computed
     std::vector<ValuePtr> list_value;
-    std::map<std::string, ValuePtr> dict_value;
+    Dict dict_value;
     
     // Lambda function storage
     std::vector<std::string> lambda_params;
@@ -42,71 +372,139 @@ public:
     
     // Instance storage
     std::string class_name;  // Name of the class
-    std::map<std::string, ValuePtr> instance_properties;  // Instance variables
+    ShapePtr shape;  // Property layout shared with other instances
+    std::vector<ValuePtr> instance_slots;  // Instance variables, indexed by shape
     
     // Generator storage
     std::vector<ValuePtr> generator_values;  // Pre-computed values for simple generators
     size_t generator_index;  // Current position in generator
     
-    Value() : type(ValueType::NULL_TYPE), bool_value(false), number_value(0.0), generator_index(0) {}
+    // A Value's type is fixed at construction; it is counted by type while
+    // alive, and containers are linked into a per-thread list for the cycle
+    // collector (susa_heap.hpp)
+    explicit Value(ValueType value_type = ValueType::NULL_TYPE)
+        : type(value_type), bool_value(false), number_value(0.0), int_value(0), string_hash(0), generator_index(0) {
+        ValueCounters::created[static_cast<size_t>(type)]++;
+        ValueCounters::live[static_cast<size_t>(type)]++;
+        if (is_container_type(type)) {
+            container_next = container_list;
+            if (container_list != nullptr) {
+                container_list->container_prev = this;
+            }
+            container_list = this;
+        }
+    }
+    
+    ~Value() {
+        ValueCounters::live[static_cast<size_t>(type)]--;
+        if (is_container_type(type)) {
+            if (container_prev != nullptr) {
+                container_prev->container_next = container_next;
+            } else {
+                container_list = container_next;
+            }
+            if (container_next != nullptr) {
+                container_next->container_prev = container_prev;
+            }
+        }
+    }
+    
+    Value(const Value&) = delete;
+    Value& operator=(const Value&) = delete;
+    
+    static ValuePtr allocate(ValueType value_type) {
+        return std::make_shared<Value>(value_type);
+    }
+    
+    // Types whose values hold other values (and can form reference cycles)
+    static bool is_container_type(ValueType value_type) {
+        return value_type == ValueType::LIST || value_type == ValueType::DICT ||
+               value_type == ValueType::INSTANCE || value_type == ValueType::GENERATOR;
+    }
+    
+    // Live containers created on this thread
+    static Value* first_container() {
+        return container_list;
+    }
+    
+    Value* next_container() const {
+        return container_next;
+    }
     
     static ValuePtr make_null() {
-        return std::make_shared<Value>();
+        return allocate(ValueType::NULL_TYPE);
     }
     
     static ValuePtr make_bool(bool val) {
-        auto v = std::make_shared<Value>();
-        v->type = ValueType::BOOLEAN;
+        auto v = allocate(ValueType::BOOLEAN);
         v->bool_value = val;
         return v;
     }
     
     static ValuePtr make_number(double val) {
-        auto v = std::make_shared<Value>();
-        v->type = ValueType::NUMBER;
+        auto v = allocate(ValueType::NUMBER);
         v->number_value = val;
         return v;
     }
     
+    static ValuePtr make_int(int64_t val) {
+        auto v = allocate(ValueType::INTEGER);
+        v->int_value = val;
+        return v;
+    }
+    
     static ValuePtr make_string(const std::string& val) {
-        auto v = std::make_shared<Value>();
-        v->type = ValueType::STRING;
+        auto v = allocate(ValueType::STRING);
         v->string_value = val;
         return v;
     }
     
     static ValuePtr make_list(const std::vector<ValuePtr>& val = {}) {
-        auto v = std::make_shared<Value>();
-        v->type = ValueType::LIST;
+        auto v = allocate(ValueType::LIST);
         v->list_value = val;
         return v;
     }
     
-    static ValuePtr make_dict(const std::map<std::string, ValuePtr>& val = {}) {
-        auto v = std::make_shared<Value>();
-        v->type = ValueType::DICT;
+    static ValuePtr make_dict(const Dict& val = Dict()) {
+        auto v = allocate(ValueType::DICT);
         v->dict_value = val;
         return v;
     }
     
     static ValuePtr make_lambda(const std::vector<std::string>& params, const std::string& body) {
-        auto v = std::make_shared<Value>();
-        v->type = ValueType::LAMBDA;
+        auto v = allocate(ValueType::LAMBDA);
         v->lambda_params = params;
         v->lambda_body = body;
         return v;
     }
     
-    static ValuePtr make_instance(const std::string& class_name) {
-        auto v = std::make_shared<Value>();
-        v->type = ValueType::INSTANCE;
+    static ValuePtr make_instance(const std::string& class_name, const ShapePtr& root_shape = nullptr) {
+        auto v = allocate(ValueType::INSTANCE);
         v->class_name = class_name;
+        v->shape = root_shape ? root_shape : std::make_shared<Shape>();
         return v;
     }
     
+    // Instance property by name (nullptr if not set)
+    ValuePtr get_property(const std::string& name) const {
+        int slot = shape->find(name);
+        return slot == Shape::NO_SLOT ? nullptr : instance_slots[slot];
+    }
+    
+    void set_property(const std::string& name, const ValuePtr& value) {
+        int slot = shape->find(name);
+        if (slot != Shape::NO_SLOT) {
+            instance_slots[slot] = value;
+            return;
+        }
+        // Move to the new shape only once its slot exists
+        ShapePtr next = shape->add_property(name);
+        instance_slots.push_back(value);
+        shape = std::move(next);
+    }
+    
     static ValuePtr make_generator(const std::vector<ValuePtr>& values) {
-        auto v = std::make_shared<Value>();
-        v->type = ValueType::GENERATOR;
+        auto v = allocate(ValueType::GENERATOR);
         v->generator_values = values;
         v->generator_index = 0;
         return v;
@@ -120,6 +518,8 @@ public:
                 return bool_value;
             case ValueType::NUMBER:
                 return number_value != 0.0;
+            case ValueType::INTEGER:
+                return int_value != 0;
             case ValueType::STRING:
                 return !string_value.empty();
             case ValueType::LIST:
@@ -131,35 +531,49 @@ public:
         }
     }
     
+    bool is_numeric() const {
+        return type == ValueType::NUMBER || type == ValueType::INTEGER;
+    }
+    
     double to_number() const {
         switch (type) {
             case ValueType::NUMBER:
                 return number_value;
+            case ValueType::INTEGER:
+                return static_cast<double>(int_value);
             case ValueType::BOOLEAN:
                 return bool_value ? 1.0 : 0.0;
-            case ValueType::STRING:
-                try {
-                    return std::stod(string_value);
-                } catch (...) {
+            case ValueType::STRING: {
+                double result = 0.0;
+                if (!parse_number(string_value, result)) {
                     return 0.0;
                 }
+                return result;
+            }
             default:
                 return 0.0;
         }
     }
     
+    int64_t to_int() const {
+        if (type == ValueType::INTEGER) {
+            return int_value;
+        }
+        return double_to_int64(to_number());
+    }
+    
     std::string to_string() const {
         switch (type) {
             case ValueType::NULL_TYPE:
                 return "null";
             case ValueType::BOOLEAN:
                 return bool_value ? "true" : "false";
-            case ValueType::NUMBER: {
-                // Format number nicely
-                if (number_value == static_cast<int>(number_value)) {
-                    return std::to_string(static_cast<int>(number_value));
-                }
-                return std::to_string(number_value);
+            case ValueType::NUMBER:
+                return format_number(number_value);
+            case ValueType::INTEGER: {
+                std::string result;
+                append_integer(result, int_value);
+                return result;
             }
             case ValueType::STRING:
                 return string_value;
@@ -175,10 +589,12 @@ public:
             case ValueType::DICT: {
                 std::string result = "{";
                 bool first = true;
-                for (const auto& pair : dict_value) {
+                for (const auto& entry : dict_value.items()) {
                     if (!first) result += ", ";
                     first = false;
-                    result += pair.first + ": " + pair.second->to_string();
+                    entry.key->append_to(result);
+                    result += ": ";
+                    entry.value->append_to(result);
                 }
                 result += "}";
                 return result;
@@ -194,11 +610,29 @@ public:
         }
     }
     
+    // Append the string form without building a temporary for scalars
+    void append_to(std::string& out) const {
+        switch (type) {
+            case ValueType::STRING:
+                out += string_value;
+                break;
+            case ValueType::NUMBER:
+                append_number(out, number_value);
+                break;
+            case ValueType::INTEGER:
+                append_integer(out, int_value);
+                break;
+            default:
+                out += to_string();
+                break;
+        }
+    }
+    
     ValuePtr clone() const {
-        auto v = std::make_shared<Value>();
-        v->type = type;
+        auto v = allocate(type);
         v->bool_value = bool_value;
         v->number_value = number_value;
+        v->int_value = int_value;
         v->string_value = string_value;
         
         // Deep copy lists
@@ -207,14 +641,147 @@ public:
         }
         
         // Deep copy dicts
-        for (const auto& pair : dict_value) {
-            v->dict_value[pair.first] = pair.second->clone();
+        v->dict_value.reserve(dict_value.size());
+        for (const auto& entry : dict_value.items()) {
+            v->dict_value.set(entry.key, entry.value->clone());
         }
         
         return v;
     }
+    
+private:
+    static inline thread_local Value* container_list = nullptr;
+    Value* container_prev = nullptr;
+    Value* container_next = nullptr;
 };
 
+// Dict members that need the complete Value type
+
+inline bool Dict::is_hashable(const ValuePtr& key) {
+    return key->type == ValueType::STRING || key->type == ValueType::BOOLEAN || key->is_numeric();
+}
+
+inline size_t Dict::hash_key(const ValuePtr& key) {
+    switch (key->type) {
+        case ValueType::STRING:
+            if (key->string_hash == 0) {
+                size_t hash = std::hash<std::string>()(key->string_value);
+                key->string_hash = hash == 0 ? 1 : hash;
+            }
+            return key->string_hash;
+        case ValueType::BOOLEAN:
+            return key->bool_value ? 0x9e3779b97f4a7c15ULL : 0x7f4a7c159e3779b9ULL;
+        case ValueType::INTEGER:
+            return std::hash<int64_t>()(key->int_value) * 0x9e3779b97f4a7c15ULL;
+        case ValueType::NUMBER: {
+            // Integral doubles hash like the equal INTEGER so 1 and 1.0 collide
+            double num = key->number_value;
+            int64_t integral;
+            if (as_int64(num, integral)) {
+                return std::hash<int64_t>()(integral) * 0x9e3779b97f4a7c15ULL;
+            }
+            if (std::isnan(num)) {
+                return 0x7ff8000000000000ULL;  // Every NaN bit pattern is one key
+            }
+            return std::hash<double>()(num);
+        }
+        default:
+            return 0;
+    }
+}
+
+inline bool Dict::keys_equal(const ValuePtr& a, const ValuePtr& b) {
+    if (a == b) {
+        return true;
+    }
+    if (a->type == ValueType::INTEGER && b->type == ValueType::INTEGER) {
+        return a->int_value == b->int_value;
+    }
+    // INTEGER against NUMBER is exact: 2^53 + 1 and 2^53 (as a double) are
+    // different keys, though converting the integer would make them equal
+    if (a->type == ValueType::INTEGER || b->type == ValueType::INTEGER) {
+        const ValuePtr& integer = a->type == ValueType::INTEGER ? a : b;
+        const ValuePtr& number = a->type == ValueType::INTEGER ? b : a;
+        int64_t integral;
+        return number->type == ValueType::NUMBER && as_int64(number->number_value, integral) &&
+               integral == integer->int_value;
+    }
+    if (a->is_numeric() && b->is_numeric()) {
+        double x = a->to_number();
+        double y = b->to_number();
+        return x == y || (std::isnan(x) && std::isnan(y));
+    }
+    if (a->type != b->type) {
+        return false;
+    }
+    if (a->type == ValueType::STRING) {
+        return a->string_value == b->string_value;
+    }
+    return a->bool_value == b->bool_value;
+}
+
+inline ValuePtr Dict::get(const ValuePtr& key) const {
+    if (entries.empty()) {
+        return nullptr;
+    }
+    size_t i = probe(key, hash_key(key));
+    return slots[i] == EMPTY_SLOT ? nullptr : entries[slots[i]].value;
+}
+
+inline void Dict::set(const ValuePtr& key, const ValuePtr& value) {
+    // Keep the load factor, tombstones included, at or below 2/3; a rebuild
+    // drops the tombstones and only doubles when live entries need it
+    if ((entries.size() + 1) * 3 > slots.size() * 2) {
+        size_t capacity = slots.empty() ? 8 : slots.size();
+        while ((live + 1) * 3 > capacity * 2) {
+            capacity *= 2;
+        }
+        rebuild(capacity);
+    }
+    size_t hash = hash_key(key);
+    size_t i = probe(key, hash);
+    if (slots[i] != EMPTY_SLOT) {
+        entries[slots[i]].value = value;
+        return;
+    }
+    // Publish the slot only once the entry it points at exists
+    entries.push_back({key, value, hash});
+    slots[i] = static_cast<int32_t>(entries.size() - 1);
+    live++;
+}
+
+inline bool Dict::erase(const ValuePtr& key) {
+    if (entries.empty()) {
+        return false;
+    }
+    size_t i = probe(key, hash_key(key));
+    if (slots[i] == EMPTY_SLOT) {
+        return false;
+    }
+    Entry& entry = entries[slots[i]];
+    entry.key = nullptr;
+    entry.value = nullptr;
+    slots[i] = DELETED_SLOT;
+    live--;
+    // Compacting once tombstones outnumber live entries keeps erase
+    // amortized O(1)
+    if (entries.size() - live > live) {
+        rebuild(slots.size());
+    }
+    return true;
+}
+
+inline void Dict::reserve(size_t count) {
+    size_t capacity = slots.empty() ? 8 : slots.size();
+    while (count * 3 > capacity * 2) {
+        capacity *= 2;
+    }
+    if (capacity != slots.size()) {
+        entries.reserve(count);
+        rebuild(capacity);  // Also compacts
+    }
+}
+
 } // namespace susa
 
 #endif // SUSA_VALUE_HPP